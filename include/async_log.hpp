@@ -0,0 +1,392 @@
+// include/async_log.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Logging asincrono por thread: sin stdio ni syscalls en el camino caliente
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Cada thread escribe registros en su propio ring SPSC: puntero al formato,
+// un thunk que sabe formatear los argumentos y los argumentos copiados por
+// valor. El formateo (snprintf) lo hace un thread flusher que junta los
+// registros de todos los rings, los ordena por timestamp y los escribe con
+// writev. Los argumentos deben ser copiables trivialmente; los const char*
+// deben apuntar a memoria que viva hasta el flush (literales, por ejemplo).
+//
+// Con --sync-log todo vuelve a stdio inmediato, para medir el "antes".
+//
+// async_log_start solo arma el modo asincrono: el flusher se crea con el
+// primer registro, asi los tests que nunca loguean no pagan un thread que
+// despierta cada LOG_IDLE_US.
+
+const int LOG_RING = 4096;          // Registros por thread (potencia de 2)
+const int LOG_PAYLOAD = 48;         // Bytes para los argumentos
+const int LOG_LINE_MAX = 256;       // Lineas mas largas se truncan
+const int LOG_BATCH = 1024;         // Registros por ronda del flusher
+const int LOG_IDLE_US = 500;        // Espera del flusher cuando no hay registros
+
+enum LogMode {
+    LOG_ASYNC,
+    LOG_SYNC
+};
+
+inline LogMode& log_mode() {
+    static LogMode mode = LOG_ASYNC;
+    return mode;
+}
+
+// Busca --sync-log en argv, lo quita y cambia el modo. Devuelve el argc nuevo.
+inline int parse_log_flag(int argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sync-log") == 0) {
+            log_mode() = LOG_SYNC;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = nullptr;
+    return out;
+}
+
+struct LogRecord {
+    uint64_t ts_ns;
+    int fd;
+    const char* fmt;
+    int (*format)(const LogRecord& rec, char* out, size_t cap);
+    alignas(8) unsigned char payload[LOG_PAYLOAD];
+};
+
+struct LogBuffer {
+    alignas(64) std::atomic<uint64_t> head;   // Solo lo avanza el thread dueño
+    alignas(64) std::atomic<uint64_t> tail;   // Solo lo avanza el flusher
+    std::atomic<bool> in_use;
+    LogRecord recs[LOG_RING];
+
+    LogBuffer() : head(0), tail(0), in_use(true) {}
+};
+
+struct AsyncLogState {
+    pthread_mutex_t registry_mutex;
+    std::vector<LogBuffer*> buffers;    // Nunca se liberan: se reusan al morir su thread
+    std::atomic<bool> armed;            // Entre async_log_start y async_log_stop
+    std::atomic<bool> running;          // El flusher existe
+    pthread_t flusher;
+    std::atomic<long> stalls;           // Veces que un productor encontro su ring lleno
+    long records;                       // Solo los modifica el flusher
+    long writev_calls;
+
+    AsyncLogState() : armed(false), running(false), stalls(0), records(0), writev_calls(0) {
+        pthread_mutex_init(&registry_mutex, nullptr);
+    }
+};
+
+inline AsyncLogState& async_log_state() {
+    static AsyncLogState state;
+    return state;
+}
+
+inline uint64_t log_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+inline int log_snprintf(char* out, size_t cap, const char* fmt) {
+    return snprintf(out, cap, "%s", fmt);
+}
+
+template <typename... Args>
+int log_snprintf(char* out, size_t cap, const char* fmt, Args... args) {
+    return snprintf(out, cap, fmt, args...);
+}
+
+inline int log_fprintf(FILE* f, const char* fmt) {
+    return fputs(fmt, f);
+}
+
+template <typename... Args>
+int log_fprintf(FILE* f, const char* fmt, Args... args) {
+    return fprintf(f, fmt, args...);
+}
+
+template <typename... Args>
+int log_format_thunk(const LogRecord& rec, char* out, size_t cap) {
+    const std::tuple<Args...>& args = *reinterpret_cast<const std::tuple<Args...>*>(rec.payload);
+    return std::apply([&](const Args&... a) { return log_snprintf(out, cap, rec.fmt, a...); }, args);
+}
+
+// Toma un ring libre y ya vaciado o crea uno nuevo
+inline LogBuffer* log_acquire_buffer() {
+    AsyncLogState& st = async_log_state();
+    pthread_mutex_lock(&st.registry_mutex);
+    for (LogBuffer* b : st.buffers) {
+        if (!b->in_use.load(std::memory_order_acquire) &&
+            b->head.load(std::memory_order_relaxed) == b->tail.load(std::memory_order_acquire)) {
+            b->in_use.store(true, std::memory_order_relaxed);
+            pthread_mutex_unlock(&st.registry_mutex);
+            return b;
+        }
+    }
+    LogBuffer* b = new LogBuffer();
+    st.buffers.push_back(b);
+    pthread_mutex_unlock(&st.registry_mutex);
+    return b;
+}
+
+// Devuelve el ring al terminar el thread; el flusher termina de vaciarlo
+struct LogBufferHandle {
+    LogBuffer* buf = nullptr;
+    ~LogBufferHandle() {
+        if (buf) {
+            buf->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+inline LogBuffer* log_thread_buffer() {
+    thread_local LogBufferHandle handle;
+    if (!handle.buf) {
+        handle.buf = log_acquire_buffer();
+    }
+    return handle.buf;
+}
+
+inline void log_write_all(int fd, struct iovec* iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(fd, iov, std::min(cnt, IOV_MAX));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        async_log_state().writev_calls++;
+        // Saltar los iovec completos y ajustar el parcial
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+struct LogPending {
+    uint64_t ts_ns;
+    const LogRecord* rec;
+};
+
+// Una ronda: junta hasta LOG_BATCH registros, los formatea y los escribe.
+// Devuelve cuantos registros escribio.
+inline int log_flush_round(std::vector<char>& arena, std::vector<LogPending>& pending,
+                           std::vector<struct iovec>& iov) {
+    AsyncLogState& st = async_log_state();
+    pthread_mutex_lock(&st.registry_mutex);
+    std::vector<LogBuffer*> buffers = st.buffers;
+    pthread_mutex_unlock(&st.registry_mutex);
+
+    pending.clear();
+    std::vector<uint64_t> taken(buffers.size(), 0);
+    for (size_t i = 0; i < buffers.size() && (int)pending.size() < LOG_BATCH; i++) {
+        LogBuffer* b = buffers[i];
+        uint64_t t = b->tail.load(std::memory_order_relaxed);
+        uint64_t h = b->head.load(std::memory_order_acquire);
+        for (; t < h && (int)pending.size() < LOG_BATCH; t++, taken[i]++) {
+            const LogRecord* rec = &b->recs[t & (LOG_RING - 1)];
+            pending.push_back({rec->ts_ns, rec});
+        }
+    }
+    if (pending.empty()) {
+        return 0;
+    }
+
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const LogPending& a, const LogPending& b) { return a.ts_ns < b.ts_ns; });
+
+    // Formatear en la arena y agrupar registros consecutivos del mismo fd
+    iov.clear();
+    size_t used = 0;
+    int fd = pending[0].rec->fd;
+    for (const LogPending& p : pending) {
+        if (p.rec->fd != fd) {
+            log_write_all(fd, iov.data(), iov.size());
+            iov.clear();
+            fd = p.rec->fd;
+        }
+        char* line = arena.data() + used;
+        int len = p.rec->format(*p.rec, line, LOG_LINE_MAX);
+        len = std::max(0, std::min(len, LOG_LINE_MAX - 1));
+        iov.push_back({line, (size_t)len});
+        used += len;
+    }
+    log_write_all(fd, iov.data(), iov.size());
+
+    // Liberar los registros ya escritos
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (taken[i]) {
+            buffers[i]->tail.fetch_add(taken[i], std::memory_order_release);
+        }
+    }
+    st.records += pending.size();
+    return pending.size();
+}
+
+inline void* log_flusher(void*) {
+    AsyncLogState& st = async_log_state();
+    std::vector<char> arena((size_t)LOG_BATCH * LOG_LINE_MAX);
+    std::vector<LogPending> pending;
+    std::vector<struct iovec> iov;
+    pending.reserve(LOG_BATCH);
+    iov.reserve(LOG_BATCH);
+
+    while (true) {
+        bool was_running = st.running.load(std::memory_order_acquire);
+        if (log_flush_round(arena, pending, iov) == 0) {
+            if (!was_running) {
+                break;
+            }
+            usleep(LOG_IDLE_US);
+        }
+    }
+    return nullptr;
+}
+
+inline void async_log_start() {
+    if (log_mode() == LOG_ASYNC) {
+        async_log_state().armed.store(true);
+    }
+}
+
+// Crea el flusher con el primer registro. Devuelve false si el modo
+// asincrono no esta armado.
+inline bool async_log_launch() {
+    AsyncLogState& st = async_log_state();
+    pthread_mutex_lock(&st.registry_mutex);
+    if (st.armed.load() && !st.running.load()) {
+        st.running.store(true, std::memory_order_release);
+        pthread_create(&st.flusher, nullptr, log_flusher, nullptr);
+    }
+    bool running = st.running.load();
+    pthread_mutex_unlock(&st.registry_mutex);
+    return running;
+}
+
+// Vacia lo pendiente y detiene el flusher
+inline void async_log_stop() {
+    AsyncLogState& st = async_log_state();
+    st.armed.store(false);
+    if (st.running.load()) {
+        st.running.store(false, std::memory_order_release);
+        pthread_join(st.flusher, nullptr);
+    }
+}
+
+// Espera a que el flusher escriba todo lo publicado hasta ahora
+inline void async_log_drain() {
+    AsyncLogState& st = async_log_state();
+    if (!st.running.load()) {
+        return;
+    }
+    while (true) {
+        bool empty = true;
+        pthread_mutex_lock(&st.registry_mutex);
+        for (LogBuffer* b : st.buffers) {
+            if (b->head.load(std::memory_order_acquire) != b->tail.load(std::memory_order_acquire)) {
+                empty = false;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&st.registry_mutex);
+        if (empty) {
+            return;
+        }
+        usleep(100);
+    }
+}
+
+// Punto de orden entre stdio y el logger: vacia stdout y los rings para que
+// los printf de antes y despues no se mezclen con los registros diferidos
+inline void async_log_barrier() {
+    fflush(stdout);
+    async_log_drain();
+}
+
+// Publica un registro para fd. Si el modo asincrono no esta armado formatea
+// y escribe en el momento.
+template <typename... Args>
+void async_log(int fd, const char* fmt, Args... args) {
+    typedef std::tuple<Args...> Payload;
+    static_assert(sizeof(Payload) <= LOG_PAYLOAD, "too many log arguments");
+    static_assert(std::conjunction<std::is_trivially_copyable<Args>...>::value,
+                  "log arguments are copied by value and formatted later");
+
+    AsyncLogState& st = async_log_state();
+    if (!st.running.load(std::memory_order_acquire) &&
+        (!st.armed.load(std::memory_order_relaxed) || !async_log_launch())) {
+        char line[LOG_LINE_MAX];
+        int len = log_snprintf(line, sizeof(line), fmt, args...);
+        len = std::max(0, std::min(len, LOG_LINE_MAX - 1));
+        ssize_t ignored = write(fd, line, len);
+        (void)ignored;
+        return;
+    }
+
+    LogBuffer* b = log_thread_buffer();
+    uint64_t h = b->head.load(std::memory_order_relaxed);
+    while (h - b->tail.load(std::memory_order_acquire) >= (uint64_t)LOG_RING) {
+        st.stalls.fetch_add(1, std::memory_order_relaxed);
+        sched_yield();
+    }
+    LogRecord& rec = b->recs[h & (LOG_RING - 1)];
+    rec.ts_ns = log_now_ns();
+    rec.fd = fd;
+    rec.fmt = fmt;
+    rec.format = &log_format_thunk<Args...>;
+    new (rec.payload) Payload(args...);
+    b->head.store(h + 1, std::memory_order_release);
+}
+
+// printf/fprintf segun el modo: stdio inmediato con --sync-log, diferido si no
+template <typename... Args>
+void log_printf(FILE* f, const char* fmt, Args... args) {
+    if (log_mode() == LOG_SYNC) {
+        log_fprintf(f, fmt, args...);
+    } else {
+        async_log(fileno(f), fmt, args...);
+    }
+}
+
+// Solo si hubo algo que reportar: con --sync-log o con registros diferidos
+inline void print_async_log_stats() {
+    AsyncLogState& st = async_log_state();
+    if (log_mode() == LOG_SYNC) {
+        printf("Logging: synchronous stdio (--sync-log)\n");
+        return;
+    }
+    if (st.records == 0) {
+        return;
+    }
+    printf("Logging: async, %ld records, %ld writev calls, %ld producer stalls\n",
+           st.records, st.writev_calls, st.stalls.load());
+}
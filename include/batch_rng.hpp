@@ -0,0 +1,182 @@
+// include/batch_rng.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Generador Philox4x32-10 por contador para llenar lotes completos de una vez
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BATCH_RNG_X86 1
+#endif
+
+// Philox es una funcion pura de (contador, llave): no hay estado que avanzar
+// elemento por elemento, asi que 8 bloques independientes caben en los
+// lanes de un vector AVX2. Cada grupo de 8 contadores produce 32 palabras en
+// orden "por palabra" (c0 de los 8 bloques, luego c1, ...); el camino escalar
+// sigue el mismo orden y da exactamente la misma secuencia.
+//
+// La llave es la semilla y c2/c3 llevan el id de stream, asi cada etapa (o
+// cada lote) tiene su propia secuencia reproducible. Un llenado siempre
+// consume grupos completos: lo que sobra del ultimo grupo se descarta.
+//
+// El rango se reduce con multiply-shift ((x * range) >> 32), sin division;
+// el sesgo es a lo sumo range / 2^32.
+
+const int PHILOX_LANES = 8;                     // Bloques por grupo
+const int PHILOX_GROUP = 4 * PHILOX_LANES;      // Palabras por grupo
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+
+struct Philox4x32 {
+    uint32_t key[2];
+    uint64_t counter;   // Siempre multiplo de PHILOX_LANES
+    uint32_t stream[2];
+};
+
+inline void philox_seed(Philox4x32* rng, uint64_t seed, uint64_t stream) {
+    rng->key[0] = (uint32_t)seed;
+    rng->key[1] = (uint32_t)(seed >> 32);
+    rng->counter = 0;
+    rng->stream[0] = (uint32_t)stream;
+    rng->stream[1] = (uint32_t)(stream >> 32);
+}
+
+inline void philox_block(uint32_t c[4], uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c[0];
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c[2];
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+        uint32_t n1 = (uint32_t)p1;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+        uint32_t n3 = (uint32_t)p0;
+        c[0] = n0;
+        c[1] = n1;
+        c[2] = n2;
+        c[3] = n3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// Un grupo de 8 bloques en orden por palabra
+inline void philox_group_scalar(Philox4x32* rng, uint32_t out[PHILOX_GROUP]) {
+    for (int lane = 0; lane < PHILOX_LANES; lane++) {
+        uint64_t ctr = rng->counter + lane;
+        uint32_t c[4] = {(uint32_t)ctr, (uint32_t)(ctr >> 32), rng->stream[0], rng->stream[1]};
+        philox_block(c, rng->key[0], rng->key[1]);
+        for (int w = 0; w < 4; w++) {
+            out[w * PHILOX_LANES + lane] = c[w];
+        }
+    }
+    rng->counter += PHILOX_LANES;
+}
+
+inline int philox_reduce(uint32_t x, int lo, uint32_t range) {
+    return lo + (int)(((uint64_t)x * range) >> 32);
+}
+
+// Llena out[0..n) con enteros uniformes en [lo, hi]
+inline void philox_fill_scalar(Philox4x32* rng, int* out, int n, int lo, int hi) {
+    uint32_t range = (uint32_t)(hi - lo + 1);
+    uint32_t words[PHILOX_GROUP];
+    for (int i = 0; i < n; i += PHILOX_GROUP) {
+        philox_group_scalar(rng, words);
+        int take = (n - i < PHILOX_GROUP) ? n - i : PHILOX_GROUP;
+        for (int j = 0; j < take; j++) {
+            out[i + j] = philox_reduce(words[j], lo, range);
+        }
+    }
+}
+
+#ifdef BATCH_RNG_X86
+
+// Producto 32x32 de los 8 lanes: mitad baja y mitad alta por separado
+__attribute__((target("avx2")))
+inline void philox_mul_avx2(__m256i a, __m256i m, __m256i* lo, __m256i* hi) {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+__attribute__((target("avx2")))
+inline void philox_fill_avx2(Philox4x32* rng, int* out, int n, int lo, int hi) {
+    const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+    const __m256i lane_ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i vrange = _mm256_set1_epi32(hi - lo + 1);
+    const __m256i vlo = _mm256_set1_epi32(lo);
+    alignas(32) int tail[PHILOX_GROUP];
+
+    for (int i = 0; i < n; i += PHILOX_GROUP) {
+        // counter es multiplo de 8: la parte baja + lane nunca desborda
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((uint32_t)rng->counter), lane_ids);
+        __m256i c1 = _mm256_set1_epi32((uint32_t)(rng->counter >> 32));
+        __m256i c2 = _mm256_set1_epi32(rng->stream[0]);
+        __m256i c3 = _mm256_set1_epi32(rng->stream[1]);
+        uint32_t k0 = rng->key[0], k1 = rng->key[1];
+
+        for (int round = 0; round < 10; round++) {
+            __m256i lo0, hi0, lo1, hi1;
+            philox_mul_avx2(c0, m0, &lo0, &hi0);
+            philox_mul_avx2(c2, m1, &lo1, &hi1);
+            __m256i n0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(k0));
+            __m256i n2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(k1));
+            c0 = n0;
+            c1 = lo1;
+            c2 = n2;
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        rng->counter += PHILOX_LANES;
+
+        __m256i words[4] = {c0, c1, c2, c3};
+        int* dst = (n - i >= PHILOX_GROUP) ? out + i : tail;
+        for (int w = 0; w < 4; w++) {
+            __m256i r_lo, r_hi;
+            philox_mul_avx2(words[w], vrange, &r_lo, &r_hi);
+            _mm256_storeu_si256((__m256i*)(dst + w * PHILOX_LANES), _mm256_add_epi32(vlo, r_hi));
+        }
+        if (dst == tail) {
+            for (int j = 0; j < n - i; j++) {
+                out[i + j] = tail[j];
+            }
+        }
+    }
+}
+
+#endif  // BATCH_RNG_X86
+
+typedef void (*PhiloxFillFn)(Philox4x32* rng, int* out, int n, int lo, int hi);
+
+inline PhiloxFillFn philox_fill_for(bool use_avx2) {
+#ifdef BATCH_RNG_X86
+    if (use_avx2) {
+        return philox_fill_avx2;
+    }
+#endif
+    (void)use_avx2;
+    return philox_fill_scalar;
+}
+
+inline bool philox_has_avx2() {
+#ifdef BATCH_RNG_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+// Llenado elegido una vez segun la CPU
+inline void philox_fill(Philox4x32* rng, int* out, int n, int lo, int hi) {
+    static PhiloxFillFn fn = philox_fill_for(philox_has_avx2());
+    fn(rng, out, n, lo, hi);
+}
@@ -0,0 +1,248 @@
+// include/coro_pipeline.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Etapas como corrutinas de C++20 multiplexadas sobre un pool pequeño de threads
+
+#pragma once
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#include <pthread.h>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include "stage_pipeline.hpp"
+
+#define CORO_PIPELINE_AVAILABLE 1
+
+// Cada etapa es una corrutina que espera en canales asincronos en lugar de
+// bloquear un thread en pthread_cond_wait. Una corrutina lista va a la cola
+// del scheduler y cualquiera de sus N threads la reanuda.
+//
+// El marco de cada corrutina se reserva una vez al crearla; suspender y
+// reanudar solo mueven un coroutine_handle (un puntero) por rings ya
+// reservados, sin tocar el heap.
+
+struct CoroScheduler {
+    StageChannel<std::coroutine_handle<>> ready;
+    std::vector<pthread_t> pool;
+    std::atomic<int> live;       // Corrutinas que no han terminado
+    std::atomic<long> resumes;   // Cambios de corrutina hechos en espacio de usuario
+
+    // capacity >= numero de corrutinas: cada una esta a lo sumo una vez en la
+    // cola, asi schedule() nunca espera
+    CoroScheduler(size_t capacity, int threads) : ready(capacity), pool(threads), live(0), resumes(0) {}
+
+    void schedule(std::coroutine_handle<> h) {
+        ready.push(h);
+    }
+
+    void finished() {
+        if (live.fetch_sub(1) == 1) {
+            ready.close();
+        }
+    }
+
+    static void* worker_main(void* p) {
+        CoroScheduler* sched = static_cast<CoroScheduler*>(p);
+        std::coroutine_handle<> h;
+        long resumed = 0;
+        while (sched->ready.pop(&h)) {
+            h.resume();
+            resumed++;
+        }
+        sched->resumes.fetch_add(resumed);
+        return nullptr;
+    }
+
+    // Corre hasta que todas las corrutinas terminan
+    void run() {
+        if (live.load() == 0) {
+            return;
+        }
+        for (pthread_t& th : pool) {
+            pthread_create(&th, nullptr, worker_main, this);
+        }
+        for (pthread_t& th : pool) {
+            pthread_join(th, nullptr);
+        }
+    }
+};
+
+// Corrutina de etapa: arranca suspendida hasta que start() la encola y al
+// terminar queda suspendida para que su dueño destruya el marco
+struct CoroTask {
+    struct promise_type {
+        CoroScheduler* sched = nullptr;
+
+        CoroTask get_return_object() {
+            return CoroTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                h.promise().sched->finished();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    void start(CoroScheduler* sched) {
+        handle.promise().sched = sched;
+        sched->live.fetch_add(1);
+        sched->schedule(handle);
+    }
+
+    void destroy() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+};
+
+// Canal acotado de un productor y un consumidor entre corrutinas. Con un solo
+// lado de cada tipo, quien despierta a una corrutina garantiza que al
+// reanudarse su operacion ya puede completarse.
+template <typename T, size_t N>
+struct CoroChannel {
+    T buf[N];
+    size_t head;
+    size_t count;
+    bool closed;
+    pthread_mutex_t mutex;
+    std::coroutine_handle<> reader;
+    std::coroutine_handle<> writer;
+    CoroScheduler* sched;
+
+    explicit CoroChannel(CoroScheduler* s) : head(0), count(0), closed(false), sched(s) {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~CoroChannel() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    CoroChannel(const CoroChannel&) = delete;
+    CoroChannel& operator=(const CoroChannel&) = delete;
+
+    // Saca al que espera (si hay) bajo el lock; se encola ya sin el lock
+    static std::coroutine_handle<> take_waiter(std::coroutine_handle<>& waiter) {
+        std::coroutine_handle<> h = waiter;
+        waiter = nullptr;
+        return h;
+    }
+
+    void wake(std::coroutine_handle<> h) {
+        if (h) {
+            sched->schedule(h);
+        }
+    }
+
+    struct PushAwaiter {
+        CoroChannel* ch;
+        const T* item;
+
+        bool await_ready() {
+            return false;
+        }
+
+        // false = hay espacio, no suspender
+        bool await_suspend(std::coroutine_handle<> h) {
+            pthread_mutex_lock(&ch->mutex);
+            if (ch->count < N) {
+                pthread_mutex_unlock(&ch->mutex);
+                return false;
+            }
+            ch->writer = h;
+            pthread_mutex_unlock(&ch->mutex);
+            return true;
+        }
+
+        void await_resume() {
+            pthread_mutex_lock(&ch->mutex);
+            ch->buf[(ch->head + ch->count) % N] = *item;
+            ch->count++;
+            std::coroutine_handle<> h = take_waiter(ch->reader);
+            pthread_mutex_unlock(&ch->mutex);
+            ch->wake(h);
+        }
+    };
+
+    struct PopAwaiter {
+        CoroChannel* ch;
+        T* out;
+
+        bool await_ready() {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            pthread_mutex_lock(&ch->mutex);
+            if (ch->count > 0 || ch->closed) {
+                pthread_mutex_unlock(&ch->mutex);
+                return false;
+            }
+            ch->reader = h;
+            pthread_mutex_unlock(&ch->mutex);
+            return true;
+        }
+
+        // false solo si el canal esta cerrado y vacio
+        bool await_resume() {
+            pthread_mutex_lock(&ch->mutex);
+            if (ch->count == 0) {
+                pthread_mutex_unlock(&ch->mutex);
+                return false;
+            }
+            *out = ch->buf[ch->head];
+            ch->head = (ch->head + 1) % N;
+            ch->count--;
+            std::coroutine_handle<> h = take_waiter(ch->writer);
+            pthread_mutex_unlock(&ch->mutex);
+            ch->wake(h);
+            return true;
+        }
+    };
+
+    PushAwaiter push(const T& item) {
+        return PushAwaiter{this, &item};
+    }
+
+    PopAwaiter pop(T* out) {
+        return PopAwaiter{this, out};
+    }
+
+    void close() {
+        pthread_mutex_lock(&mutex);
+        closed = true;
+        std::coroutine_handle<> h = take_waiter(reader);
+        pthread_mutex_unlock(&mutex);
+        wake(h);
+    }
+};
+
+#endif  // C++20 con <coroutine>
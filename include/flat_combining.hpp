@@ -0,0 +1,86 @@
+// include/flat_combining.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Flat combining: un thread aplica en lote las operaciones publicadas por los demas
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <sched.h>
+
+// Cada thread publica su operacion en un slot propio (una linea de cache).
+// Quien obtiene el lock del combinador recorre todos los slots y aplica las
+// operaciones pendientes con los datos ya calientes en su cache; los demas
+// solo esperan a que su slot vuelva a quedar libre.
+//
+// Op lleva la peticion y el resultado; Apply es un functor void(Op&) que
+// opera sobre la estructura secuencial protegida.
+template <typename Op, typename Apply>
+struct FlatCombiner {
+    struct alignas(64) Slot {
+        std::atomic<int> pending;
+        Op op;
+    };
+
+    static const int COMBINE_PASSES = 2;   // Recorridos por turno de combinador
+    static const int SPINS_BEFORE_YIELD = 64;
+
+    std::vector<Slot> slots;
+    Apply apply;
+    alignas(64) std::atomic<bool> locked;
+    long combines;      // Turnos de combinador (solo los modifica quien tiene el lock)
+    long combined_ops;  // Operaciones aplicadas en esos turnos
+
+    FlatCombiner(int nthreads, Apply fn)
+        : slots(nthreads), apply(fn), locked(false), combines(0), combined_ops(0) {
+        for (auto& s : slots) {
+            s.pending.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Publica op en el slot del thread y regresa con el resultado aplicado
+    void execute(int slot_id, Op& op) {
+        Slot& mine = slots[slot_id];
+        mine.op = op;
+        mine.pending.store(1, std::memory_order_release);
+
+        int spins = 0;
+        while (mine.pending.load(std::memory_order_acquire)) {
+            if (!locked.load(std::memory_order_relaxed) &&
+                !locked.exchange(true, std::memory_order_acquire)) {
+                combine();
+                locked.store(false, std::memory_order_release);
+                continue;
+            }
+            if (++spins == SPINS_BEFORE_YIELD) {
+                spins = 0;
+                sched_yield();
+            }
+        }
+        op = mine.op;
+    }
+
+    double avg_batch() const {
+        return combines ? (double)combined_ops / combines : 0.0;
+    }
+
+    void combine() {
+        combines++;
+        for (int pass = 0; pass < COMBINE_PASSES; pass++) {
+            int applied = 0;
+            for (auto& s : slots) {
+                if (s.pending.load(std::memory_order_acquire)) {
+                    apply(s.op);
+                    s.pending.store(0, std::memory_order_release);
+                    applied++;
+                }
+            }
+            combined_ops += applied;
+            if (applied == 0) {
+                break;
+            }
+        }
+    }
+};
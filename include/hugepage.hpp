@@ -0,0 +1,155 @@
+// include/hugepage.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Reservar regiones grandes (buckets, pools, rings) con paginas de 2 MiB
+
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// Activado con --hugepages; apagado, las regiones se marcan MADV_NOHUGEPAGE
+// para que la comparacion no dependa de que THP este en modo "always"
+inline bool& hugepages_enabled() {
+    static bool enabled = false;
+    return enabled;
+}
+
+// Bytes servidos por cada mecanismo, para reportar que respaldo se obtuvo
+struct HugeStats {
+    size_t hugetlb_bytes;
+    size_t thp_bytes;
+    size_t small_bytes;
+};
+
+inline HugeStats& huge_stats() {
+    static HugeStats stats = {0, 0, 0};
+    return stats;
+}
+
+inline size_t huge_round(size_t bytes, size_t page) {
+    return (bytes + page - 1) / page * page;
+}
+
+// Pagina normal del sistema (4 KiB en x86)
+inline size_t small_page_size() {
+    static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return page;
+}
+
+// Busca --hugepages en argv, lo quita y activa la opcion. Devuelve el argc nuevo.
+inline int parse_hugepages_flag(int argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hugepages") == 0) {
+            hugepages_enabled() = true;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = nullptr;
+    return out;
+}
+
+// Reserva bytes en memoria anonima inicializada en cero (lanza bad_alloc
+// igual que new si no hay memoria). Con huge pages
+// activadas intenta MAP_HUGETLB (requiere paginas reservadas en el sistema);
+// si falla, alinea un mmap normal a 2 MiB y pide THP con madvise. Si THP
+// tampoco esta disponible la region queda en paginas de 4 KiB.
+//
+// Las regiones de al menos 2 MiB mapean un multiplo de 2 MiB en ambos
+// caminos. Las mas chicas (un ring, un chunk) se redondean a la pagina
+// normal; con la opcion activada solo MAP_HUGETLB les da una pagina de 2 MiB,
+// porque THP no puede respaldar una region menor a una huge page.
+inline void* huge_alloc(size_t bytes) {
+    bool small = bytes < HUGE_PAGE_SIZE;
+    size_t len = huge_round(bytes, small ? small_page_size() : HUGE_PAGE_SIZE);
+    
+    if (!hugepages_enabled()) {
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_NOHUGEPAGE
+        madvise(p, len, MADV_NOHUGEPAGE);
+#endif
+        huge_stats().small_bytes += bytes;
+        return p;
+    }
+    
+#ifdef MAP_HUGETLB
+    void* p = mmap(nullptr, huge_round(bytes, HUGE_PAGE_SIZE), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+        huge_stats().hugetlb_bytes += bytes;
+        return p;
+    }
+#endif
+    
+    if (small) {
+        void* q = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (q == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        huge_stats().small_bytes += bytes;
+        return q;
+    }
+    
+    // Reservar de mas para poder recortar a un limite de 2 MiB
+    size_t span = len + HUGE_PAGE_SIZE;
+    char* raw = static_cast<char*>(mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    char* aligned = reinterpret_cast<char*>(huge_round(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    size_t tail = (raw + span) - (aligned + len);
+    if (tail > 0) {
+        munmap(aligned + len, tail);
+    }
+    
+#ifdef MADV_HUGEPAGE
+    if (madvise(aligned, len, MADV_HUGEPAGE) == 0) {
+        huge_stats().thp_bytes += bytes;
+        return aligned;
+    }
+#endif
+    huge_stats().small_bytes += bytes;
+    return aligned;
+}
+
+// Libera una region de huge_alloc; bytes debe ser el mismo tamaño pedido.
+// No depende de si la opcion cambio en el medio: una region chica de
+// MAP_HUGETLB rechaza (EINVAL) un largo que no es multiplo de 2 MiB, y en ese
+// caso se libera su huge page completa.
+inline void huge_free(void* p, size_t bytes) {
+    if (!p) {
+        return;
+    }
+    if (bytes >= HUGE_PAGE_SIZE) {
+        munmap(p, huge_round(bytes, HUGE_PAGE_SIZE));
+        return;
+    }
+    if (munmap(p, huge_round(bytes, small_page_size())) != 0 && errno == EINVAL) {
+        munmap(p, huge_round(bytes, HUGE_PAGE_SIZE));
+    }
+}
+
+inline void print_huge_stats() {
+    const HugeStats& s = huge_stats();
+    printf("Huge pages: %s (hugetlb %.1f MB, THP %.1f MB, 4K %.1f MB)\n",
+           hugepages_enabled() ? "on" : "off", s.hugetlb_bytes / 1048576.0,
+           s.thp_bytes / 1048576.0, s.small_bytes / 1048576.0);
+}
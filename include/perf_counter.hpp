@@ -0,0 +1,75 @@
+// include/perf_counter.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Contar misses de dTLB con perf_event_open (solo Linux)
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// Contador de misses de lectura en el dTLB del proceso. Se hereda a los
+// threads creados despues de start(). Si el kernel no permite perf events
+// (contenedores, perf_event_paranoid alto, macOS) ok queda en false.
+struct DtlbCounter {
+    int fd;
+    bool ok;
+    
+    DtlbCounter() : fd(-1), ok(false) {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        ok = fd >= 0;
+#endif
+    }
+    
+    ~DtlbCounter() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    
+    DtlbCounter(const DtlbCounter&) = delete;
+    DtlbCounter& operator=(const DtlbCounter&) = delete;
+    
+    void start() {
+#ifdef __linux__
+        if (ok) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    
+    // Detiene el contador y devuelve los misses, o -1 si no hay contador
+    long stop() {
+#ifdef __linux__
+        if (ok) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+                return (long)value;
+            }
+        }
+#endif
+        return -1;
+    }
+};
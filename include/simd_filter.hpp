@@ -0,0 +1,261 @@
+// include/simd_filter.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Kernels SIMD (SSE4.1 / AVX2) para el filtro y la suma del pipeline
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMD_FILTER_X86 1
+#endif
+
+// Predicado del pipeline: val % 2 == 0 && val > 20. filter_sum copia los
+// elementos que pasan a out (compactados, en orden) y devuelve cuantos son;
+// en la misma pasada acumula su suma en *sum. Los kernels vectoriales
+// escriben un vector completo en cada paso, asi que out necesita n +
+// SIMD_OUT_SLACK enteros de capacidad. out puede ser el mismo in (compactar
+// en sitio): cada store cae sobre posiciones que ya se leyeron.
+//
+// Cada nivel se compila con atributos target y se elige en tiempo de
+// ejecucion, sin cambiar los flags globales del Makefile.
+
+const int SIMD_OUT_SLACK = 8;
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE4,
+    SIMD_AVX2
+};
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_SCALAR: return "scalar";
+        case SIMD_SSE4: return "sse4.1";
+        case SIMD_AVX2: return "avx2";
+    }
+    return "?";
+}
+
+inline SimdLevel simd_detect() {
+#ifdef SIMD_FILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SIMD_SSE4;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+typedef int (*FilterSumFn)(const int* in, int n, int* out, long* sum);
+typedef long (*SumFn)(const int* in, int n);
+
+inline int filter_sum_scalar(const int* in, int n, int* out, long* sum) {
+    int kept = 0;
+    long s = 0;
+    for (int i = 0; i < n; i++) {
+        int val = in[i];
+        if (val % 2 == 0 && val > 20) {
+            out[kept++] = val;
+            s += val;
+        }
+    }
+    *sum = s;
+    return kept;
+}
+
+inline long sum_scalar(const int* in, int n) {
+    long s = 0;
+    for (int i = 0; i < n; i++) {
+        s += in[i];
+    }
+    return s;
+}
+
+#ifdef SIMD_FILTER_X86
+
+// Tablas de compactacion indexadas por la mascara del predicado: para cada
+// mascara, los indices de los lanes que sobreviven van primero
+struct SimdMaskTables {
+    alignas(16) uint8_t sse[16][16];     // Control de _mm_shuffle_epi8 (4 lanes)
+    alignas(32) int32_t avx2[256][8];    // Indices de _mm256_permutevar8x32_epi32 (8 lanes)
+
+    SimdMaskTables() {
+        for (int mask = 0; mask < 16; mask++) {
+            int k = 0;
+            memset(sse[mask], 0x80, 16);
+            for (int lane = 0; lane < 4; lane++) {
+                if (mask & (1 << lane)) {
+                    for (int b = 0; b < 4; b++) {
+                        sse[mask][k * 4 + b] = lane * 4 + b;
+                    }
+                    k++;
+                }
+            }
+        }
+        for (int mask = 0; mask < 256; mask++) {
+            int k = 0;
+            for (int lane = 0; lane < 8; lane++) {
+                if (mask & (1 << lane)) {
+                    avx2[mask][k++] = lane;
+                }
+            }
+            while (k < 8) {
+                avx2[mask][k++] = 0;
+            }
+        }
+    }
+};
+
+inline const SimdMaskTables& simd_mask_tables() {
+    static SimdMaskTables tables;
+    return tables;
+}
+
+__attribute__((target("sse4.1")))
+inline int filter_sum_sse4(const int* in, int n, int* out, long* sum) {
+    const SimdMaskTables& tables = simd_mask_tables();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i twenty = _mm_set1_epi32(20);
+    __m128i acc_lo = _mm_setzero_si128();
+    __m128i acc_hi = _mm_setzero_si128();
+    int kept = 0;
+    int i = 0;
+
+    // 16 enteros por iteracion: cuatro vectores de 4
+    for (; i + 16 <= n; i += 16) {
+        for (int j = 0; j < 16; j += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(in + i + j));
+            __m128i even = _mm_cmpeq_epi32(_mm_and_si128(v, one), zero);
+            __m128i m = _mm_and_si128(even, _mm_cmpgt_epi32(v, twenty));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+
+            __m128i ctrl = _mm_load_si128((const __m128i*)tables.sse[mask]);
+            _mm_storeu_si128((__m128i*)(out + kept), _mm_shuffle_epi8(v, ctrl));
+            kept += __builtin_popcount(mask);
+
+            __m128i sv = _mm_and_si128(v, m);
+            acc_lo = _mm_add_epi64(acc_lo, _mm_cvtepi32_epi64(sv));
+            acc_hi = _mm_add_epi64(acc_hi, _mm_cvtepi32_epi64(_mm_srli_si128(sv, 8)));
+        }
+    }
+
+    __m128i acc = _mm_add_epi64(acc_lo, acc_hi);
+    long s = _mm_cvtsi128_si64(acc) + _mm_extract_epi64(acc, 1);
+    long tail_sum = 0;
+    kept += filter_sum_scalar(in + i, n - i, out + kept, &tail_sum);
+    *sum = s + tail_sum;
+    return kept;
+}
+
+__attribute__((target("sse4.1")))
+inline long sum_sse4(const int* in, int n) {
+    __m128i acc_lo = _mm_setzero_si128();
+    __m128i acc_hi = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        acc_lo = _mm_add_epi64(acc_lo, _mm_cvtepi32_epi64(v));
+        acc_hi = _mm_add_epi64(acc_hi, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    __m128i acc = _mm_add_epi64(acc_lo, acc_hi);
+    return _mm_cvtsi128_si64(acc) + _mm_extract_epi64(acc, 1) + sum_scalar(in + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline int filter_sum_avx2(const int* in, int n, int* out, long* sum) {
+    const SimdMaskTables& tables = simd_mask_tables();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i twenty = _mm256_set1_epi32(20);
+    __m256i acc_lo = _mm256_setzero_si256();
+    __m256i acc_hi = _mm256_setzero_si256();
+    int kept = 0;
+    int i = 0;
+
+    // 16 enteros por iteracion: dos vectores de 8
+    for (; i + 16 <= n; i += 16) {
+        for (int j = 0; j < 16; j += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(in + i + j));
+            __m256i even = _mm256_cmpeq_epi32(_mm256_and_si256(v, one), zero);
+            __m256i m = _mm256_and_si256(even, _mm256_cmpgt_epi32(v, twenty));
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+
+            __m256i idx = _mm256_load_si256((const __m256i*)tables.avx2[mask]);
+            _mm256_storeu_si256((__m256i*)(out + kept), _mm256_permutevar8x32_epi32(v, idx));
+            kept += __builtin_popcount(mask);
+
+            __m256i sv = _mm256_and_si256(v, m);
+            acc_lo = _mm256_add_epi64(acc_lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(sv)));
+            acc_hi = _mm256_add_epi64(acc_hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(sv, 1)));
+        }
+    }
+
+    __m256i acc = _mm256_add_epi64(acc_lo, acc_hi);
+    __m128i acc2 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    long s = _mm_cvtsi128_si64(acc2) + _mm_extract_epi64(acc2, 1);
+    long tail_sum = 0;
+    kept += filter_sum_scalar(in + i, n - i, out + kept, &tail_sum);
+    *sum = s + tail_sum;
+    return kept;
+}
+
+__attribute__((target("avx2")))
+inline long sum_avx2(const int* in, int n) {
+    __m256i acc_lo = _mm256_setzero_si256();
+    __m256i acc_hi = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+        acc_lo = _mm256_add_epi64(acc_lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc_hi = _mm256_add_epi64(acc_hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    __m256i acc = _mm256_add_epi64(acc_lo, acc_hi);
+    __m128i acc2 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return _mm_cvtsi128_si64(acc2) + _mm_extract_epi64(acc2, 1) + sum_scalar(in + i, n - i);
+}
+
+#endif  // SIMD_FILTER_X86
+
+inline FilterSumFn filter_sum_for(SimdLevel level) {
+#ifdef SIMD_FILTER_X86
+    switch (level) {
+        case SIMD_AVX2: return filter_sum_avx2;
+        case SIMD_SSE4: return filter_sum_sse4;
+        default: break;
+    }
+#endif
+    (void)level;
+    return filter_sum_scalar;
+}
+
+inline SumFn sum_for(SimdLevel level) {
+#ifdef SIMD_FILTER_X86
+    switch (level) {
+        case SIMD_AVX2: return sum_avx2;
+        case SIMD_SSE4: return sum_sse4;
+        default: break;
+    }
+#endif
+    (void)level;
+    return sum_scalar;
+}
+
+// Kernels elegidos una vez segun la CPU
+inline FilterSumFn filter_sum() {
+    static FilterSumFn fn = filter_sum_for(simd_detect());
+    return fn;
+}
+
+inline SumFn sum_ints() {
+    static SumFn fn = sum_for(simd_detect());
+    return fn;
+}
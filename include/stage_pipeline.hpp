@@ -0,0 +1,428 @@
+// include/stage_pipeline.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Canal acotado entre etapas y pipelines tipados Stage<In, Out> con fusion en compilacion
+
+#pragma once
+
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+
+// Canal acotado entre etapas: ring con pop O(1). push bloquea si esta lleno
+// y pop si esta vacio; try_pop_many no bloquea (para los ticks con barrera).
+// close() despierta a los consumidores cuando el productor termina.
+template <typename T>
+struct StageChannel {
+    std::vector<T> buf;
+    size_t cap;
+    size_t head;    // Proximo a sacar
+    size_t count;
+    size_t peak;    // Maxima ocupacion vista desde el ultimo reset
+    bool closed;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    
+    explicit StageChannel(size_t capacity) : buf(capacity), cap(capacity), head(0), count(0), peak(0), closed(false) {
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&not_empty, nullptr);
+        pthread_cond_init(&not_full, nullptr);
+    }
+    
+    ~StageChannel() {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&not_empty);
+        pthread_cond_destroy(&not_full);
+    }
+    
+    StageChannel(const StageChannel&) = delete;
+    StageChannel& operator=(const StageChannel&) = delete;
+    
+    // Copia n elementos; si el ring se llena espera a que el consumidor saque
+    void push_many(const T* items, size_t n) {
+        pthread_mutex_lock(&mutex);
+        while (n > 0) {
+            while (count == cap) {
+                pthread_cond_wait(&not_full, &mutex);
+            }
+            size_t chunk = std::min(n, cap - count);
+            for (size_t i = 0; i < chunk; i++) {
+                buf[(head + count + i) % cap] = items[i];
+            }
+            count += chunk;
+            peak = std::max(peak, count);
+            items += chunk;
+            n -= chunk;
+            pthread_cond_signal(&not_empty);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    void push(const T& item) {
+        push_many(&item, 1);
+    }
+    
+    size_t take_locked(T* out, size_t max) {
+        size_t n = std::min(max, count);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = buf[(head + i) % cap];
+        }
+        head = (head + n) % cap;
+        count -= n;
+        if (n > 0) {
+            pthread_cond_broadcast(&not_full);
+        }
+        return n;
+    }
+    
+    // Saca hasta max sin esperar
+    size_t try_pop_many(T* out, size_t max) {
+        pthread_mutex_lock(&mutex);
+        size_t n = take_locked(out, max);
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    
+    // Espera al menos un elemento; devuelve 0 solo si el canal esta cerrado y vacio
+    size_t pop_many(T* out, size_t max) {
+        pthread_mutex_lock(&mutex);
+        while (count == 0 && !closed) {
+            pthread_cond_wait(&not_empty, &mutex);
+        }
+        size_t n = take_locked(out, max);
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    
+    bool pop(T* out) {
+        return pop_many(out, 1) == 1;
+    }
+    
+    void close() {
+        pthread_mutex_lock(&mutex);
+        closed = true;
+        pthread_cond_broadcast(&not_empty);
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    size_t size() {
+        pthread_mutex_lock(&mutex);
+        size_t n = count;
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    
+    void reset() {
+        pthread_mutex_lock(&mutex);
+        head = 0;
+        count = 0;
+        peak = 0;
+        closed = false;
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Pipelines tipados: fuente -> etapas -> sumidero
+// ---------------------------------------------------------------------------
+//
+// Una etapa es un callable bool(const In&, Out&): devuelve false para
+// descartar el elemento, asi un filtro y un map tienen la misma forma. Las
+// etapas sin estado pueden correr en varios threads y, si el pipeline se
+// arma con FUSE_STATELESS, dos etapas sin estado seguidas se fusionan en
+// compilacion en un solo loop sin canal entre ellas.
+//
+// La fuente es size_t(Out* buf, size_t max) (0 = fin) y el sumidero
+// void(const In* buf, size_t n); ambos corren en un solo thread. Los
+// elementos viajan en chunks de STAGE_CHUNK por toma del lock. Con mas de un
+// thread por etapa el orden entre chunks no se conserva.
+
+const size_t STAGE_CHUNK = 256;
+const size_t STAGE_EDGE_CAPACITY = 4096;
+
+enum FusionMode {
+    FUSE_NONE,        // Un canal y sus threads por etapa
+    FUSE_STATELESS    // Etapas sin estado adyacentes comparten loop
+};
+
+template <typename In, typename Out, typename Fn, bool Stateless>
+struct Stage {
+    typedef In in_type;
+    typedef Out out_type;
+    static constexpr bool stateless = Stateless;
+    
+    Fn fn;
+    int threads;
+    std::string name;
+    
+    bool operator()(const In& in, Out& out) {
+        return fn(in, out);
+    }
+};
+
+template <typename In, typename Out, typename Fn>
+Stage<In, Out, Fn, true> map_stage(const char* name, Fn fn, int threads = 1) {
+    return {fn, std::max(threads, 1), name};
+}
+
+// Con estado: nunca se fusiona y siempre corre en un thread
+template <typename In, typename Out, typename Fn>
+Stage<In, Out, Fn, false> stateful_stage(const char* name, Fn fn) {
+    return {fn, 1, name};
+}
+
+template <typename T, typename Pred>
+struct FilterFn {
+    Pred pred;
+    
+    bool operator()(const T& in, T& out) {
+        if (!pred(in)) {
+            return false;
+        }
+        out = in;
+        return true;
+    }
+};
+
+template <typename T, typename Pred>
+Stage<T, T, FilterFn<T, Pred>, true> filter_stage(const char* name, Pred pred, int threads = 1) {
+    return {FilterFn<T, Pred>{pred}, std::max(threads, 1), name};
+}
+
+template <typename A, typename B>
+struct FusedFn {
+    A a;
+    B b;
+    
+    bool operator()(const typename A::in_type& in, typename B::out_type& out) {
+        typename A::out_type mid;
+        return a(in, mid) && b(mid, out);
+    }
+};
+
+template <typename A, typename B>
+Stage<typename A::in_type, typename B::out_type, FusedFn<A, B>, true> fuse_stages(const A& a, const B& b) {
+    static_assert(std::is_same<typename A::out_type, typename B::in_type>::value,
+                  "fuse_stages: la salida de A no es la entrada de B");
+    return {FusedFn<A, B>{a, b}, std::max(a.threads, b.threads), a.name + "+" + b.name};
+}
+
+template <typename Out, typename Fn>
+struct Source {
+    typedef Out out_type;
+    Fn fn;
+};
+
+template <typename Out, typename Fn>
+Source<Out, Fn> make_source(Fn fn) {
+    return {fn};
+}
+
+template <typename In, typename Fn>
+struct Sink {
+    typedef In in_type;
+    Fn fn;
+};
+
+template <typename In, typename Fn>
+Sink<In, Fn> make_sink(Fn fn) {
+    return {fn};
+}
+
+// Fusion en compilacion: recorre la tupla de etapas y junta cada par
+// adyacente sin estado
+template <size_t Skip, typename Tuple, size_t... I>
+auto tuple_drop(const Tuple& t, std::index_sequence<I...>) {
+    return std::make_tuple(std::get<Skip + I>(t)...);
+}
+
+template <size_t Skip, typename... S>
+auto tuple_drop(const std::tuple<S...>& t) {
+    return tuple_drop<Skip>(t, std::make_index_sequence<sizeof...(S) - Skip>());
+}
+
+template <FusionMode Mode, typename S>
+std::tuple<S> fuse_all(const std::tuple<S>& t) {
+    return t;
+}
+
+template <FusionMode Mode, typename S1, typename S2, typename... Rest>
+auto fuse_all(const std::tuple<S1, S2, Rest...>& t) {
+    if constexpr (Mode == FUSE_STATELESS && S1::stateless && S2::stateless) {
+        return fuse_all<Mode>(std::tuple_cat(std::make_tuple(fuse_stages(std::get<0>(t), std::get<1>(t))),
+                                             tuple_drop<2>(t)));
+    } else {
+        return std::tuple_cat(std::make_tuple(std::get<0>(t)), fuse_all<Mode>(tuple_drop<1>(t)));
+    }
+}
+
+template <typename S>
+struct StageWorkerArgs {
+    S* stage;
+    StageChannel<typename S::in_type>* in;
+    StageChannel<typename S::out_type>* out;
+    std::atomic<int>* alive;
+};
+
+template <typename S>
+void* stage_worker(void* p) {
+    StageWorkerArgs<S>* args = static_cast<StageWorkerArgs<S>*>(p);
+    std::vector<typename S::in_type> in(STAGE_CHUNK);
+    std::vector<typename S::out_type> out(STAGE_CHUNK);
+    size_t n;
+    while ((n = args->in->pop_many(in.data(), STAGE_CHUNK)) > 0) {
+        size_t kept = 0;
+        for (size_t i = 0; i < n; i++) {
+            if ((*args->stage)(in[i], out[kept])) {
+                kept++;
+            }
+        }
+        args->out->push_many(out.data(), kept);
+    }
+    // El ultimo worker de la etapa cierra el canal de salida
+    if (args->alive->fetch_sub(1) == 1) {
+        args->out->close();
+    }
+    return nullptr;
+}
+
+template <typename Src>
+struct SourceWorkerArgs {
+    Src* source;
+    StageChannel<typename Src::out_type>* out;
+};
+
+template <typename Src>
+void* source_worker(void* p) {
+    SourceWorkerArgs<Src>* args = static_cast<SourceWorkerArgs<Src>*>(p);
+    std::vector<typename Src::out_type> buf(STAGE_CHUNK);
+    size_t n;
+    while ((n = args->source->fn(buf.data(), STAGE_CHUNK)) > 0) {
+        args->out->push_many(buf.data(), n);
+    }
+    args->out->close();
+    return nullptr;
+}
+
+template <typename Snk>
+struct SinkWorkerArgs {
+    Snk* sink;
+    StageChannel<typename Snk::in_type>* in;
+};
+
+template <typename Snk>
+void* sink_worker(void* p) {
+    SinkWorkerArgs<Snk>* args = static_cast<SinkWorkerArgs<Snk>*>(p);
+    std::vector<typename Snk::in_type> buf(STAGE_CHUNK);
+    size_t n;
+    while ((n = args->in->pop_many(buf.data(), STAGE_CHUNK)) > 0) {
+        args->sink->fn(buf.data(), n);
+    }
+    return nullptr;
+}
+
+template <typename Src, typename Snk, typename... Stages>
+struct LinearPipeline {
+    static constexpr size_t STAGES = sizeof...(Stages);
+    
+    Src source;
+    std::tuple<Stages...> stages;
+    Snk sink;
+    size_t edge_capacity;
+    
+    // Canal i = entrada de la etapa i; el ultimo alimenta al sumidero
+    typedef std::tuple<std::unique_ptr<StageChannel<typename Src::out_type>>,
+                       std::unique_ptr<StageChannel<typename Stages::out_type>>...> Channels;
+    
+    int thread_count() const {
+        return 2 + thread_count(std::make_index_sequence<STAGES>());
+    }
+    
+    // Nombre y threads de cada etapa ya fusionada
+    template <typename Visit>
+    void for_each_stage(Visit visit) const {
+        for_each_stage(visit, std::make_index_sequence<STAGES>());
+    }
+    
+    void run() {
+        Channels channels;
+        make_channels(channels, std::make_index_sequence<STAGES + 1>());
+        
+        std::vector<pthread_t> threads;
+        std::atomic<int> alive[STAGES > 0 ? STAGES : 1];
+        std::tuple<std::vector<StageWorkerArgs<Stages>>...> args;
+        
+        SinkWorkerArgs<Snk> sink_args = {&sink, std::get<STAGES>(channels).get()};
+        SourceWorkerArgs<Src> source_args = {&source, std::get<0>(channels).get()};
+        launch(threads, sink_worker<Snk>, &sink_args);
+        launch_stages(threads, channels, alive, args, std::make_index_sequence<STAGES>());
+        launch(threads, source_worker<Src>, &source_args);
+        
+        for (pthread_t& th : threads) {
+            pthread_join(th, nullptr);
+        }
+    }
+    
+private:
+    template <size_t... I>
+    int thread_count(std::index_sequence<I...>) const {
+        return (0 + ... + std::get<I>(stages).threads);
+    }
+    
+    template <typename Visit, size_t... I>
+    void for_each_stage(Visit& visit, std::index_sequence<I...>) const {
+        (visit(std::get<I>(stages).name.c_str(), std::get<I>(stages).threads), ...);
+    }
+    
+    template <size_t... I>
+    void make_channels(Channels& channels, std::index_sequence<I...>) {
+        ((std::get<I>(channels) = std::make_unique<typename std::tuple_element<I, Channels>::type::element_type>(
+              edge_capacity)), ...);
+    }
+    
+    static void launch(std::vector<pthread_t>& threads, void* (*fn)(void*), void* arg) {
+        pthread_t th;
+        pthread_create(&th, nullptr, fn, arg);
+        threads.push_back(th);
+    }
+    
+    template <size_t I, typename Args>
+    void launch_stage(std::vector<pthread_t>& threads, Channels& channels, std::atomic<int>* alive, Args& args) {
+        typedef typename std::tuple_element<I, std::tuple<Stages...>>::type S;
+        S& stage = std::get<I>(stages);
+        auto& stage_args = std::get<I>(args);
+        alive[I] = stage.threads;
+        // reserve: los punteros a los args no deben moverse mientras corren
+        stage_args.reserve(stage.threads);
+        for (int t = 0; t < stage.threads; t++) {
+            stage_args.push_back({&stage, std::get<I>(channels).get(), std::get<I + 1>(channels).get(), &alive[I]});
+            launch(threads, stage_worker<S>, &stage_args.back());
+        }
+    }
+    
+    template <typename Args, size_t... I>
+    void launch_stages(std::vector<pthread_t>& threads, Channels& channels, std::atomic<int>* alive, Args& args,
+                       std::index_sequence<I...>) {
+        (launch_stage<I>(threads, channels, alive, args), ...);
+    }
+};
+
+template <typename Src, typename Snk, typename... S>
+LinearPipeline<Src, Snk, S...> make_linear(const Src& source, const std::tuple<S...>& stages, const Snk& sink,
+                                           size_t edge_capacity) {
+    return {source, stages, sink, edge_capacity};
+}
+
+// Arma fuente -> etapas... -> sumidero, fusionando segun Mode
+template <FusionMode Mode, typename Src, typename Snk, typename... S>
+auto make_pipeline(const Src& source, const Snk& sink, const S&... stages) {
+    return make_linear(source, fuse_all<Mode>(std::make_tuple(stages...)), sink, STAGE_EDGE_CAPACITY);
+}
@@ -0,0 +1,204 @@
+// include/work_stealing.hpp
+// Autor: Fatima Navarro
+// Carnet: 24044
+// Fecha: 29/08/2025
+// Propósito: Scheduler work-stealing con deques Chase-Lev por worker
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Deque de Chase-Lev: el dueño empuja y saca por abajo (LIFO, datos
+// calientes); los ladrones roban por arriba (FIFO, el trabajo mas viejo) con
+// un CAS sobre top. Capacidad fija potencia de 2: si se llena, push falla y
+// quien lo llamo ejecuta la tarea en linea.
+//
+// Se usa la formulacion con operaciones seq_cst sobre top y bottom en lugar
+// de fences sueltos (version C11 de Lê et al.): TSan no modela
+// atomic_thread_fence y con fences reportaria carreras falsas.
+//
+// Las tareas son enteros de 64 bits que el usuario codifica (por ejemplo
+// lote * etapas + etapa), asi encolar nunca reserva memoria.
+struct ChaseLevDeque {
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::vector<std::atomic<uint64_t>> buf;
+    int64_t mask;
+
+    explicit ChaseLevDeque(int64_t capacity) : top(0), bottom(0), buf(capacity), mask(capacity - 1) {}
+
+    // Solo el dueño
+    bool push(uint64_t task) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > mask) {
+            return false;
+        }
+        buf[b & mask].store(task, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);   // Publica la tarea a los ladrones
+        return true;
+    }
+
+    // Solo el dueño
+    bool pop(uint64_t* task) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        // Store y load seq_cst: un ladron no puede ver el bottom viejo
+        // mientras el dueño ve el top viejo
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *task = buf[b & mask].load(std::memory_order_relaxed);
+        if (t < b) {
+            return true;
+        }
+        // Ultimo elemento: se lo disputa con los ladrones
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // Cualquier otro thread
+    bool steal(uint64_t* task) {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) {
+            return false;
+        }
+        uint64_t value = buf[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        *task = value;
+        return true;
+    }
+};
+
+typedef void (*WsTaskFn)(void* ctx, uint64_t task, int worker);
+
+struct alignas(64) WsWorkerStats {
+    long executed;
+    long steals;
+    long failed_steals;   // Rondas sin encontrar nada en ninguna victima
+};
+
+// Pool de N workers, cada uno con su deque. Una tarea puede generar sus
+// continuaciones con spawn() desde el worker que la ejecuta; el usuario llama
+// finish() cuando sabe que ya no queda trabajo.
+struct WorkStealingPool {
+    static const int64_t DEQUE_CAPACITY = 1024;
+    static const int SPINS_BEFORE_YIELD = 64;
+
+    struct WorkerArgs {
+        WorkStealingPool* pool;
+        int id;
+    };
+
+    int nworkers;
+    std::vector<ChaseLevDeque*> deques;
+    std::vector<WsWorkerStats> stats;
+    WsTaskFn fn;
+    void* ctx;
+    alignas(64) std::atomic<bool> done;
+
+    WorkStealingPool(int n, WsTaskFn task_fn, void* task_ctx)
+        : nworkers(n), stats(n), fn(task_fn), ctx(task_ctx), done(false) {
+        for (int i = 0; i < n; i++) {
+            deques.push_back(new ChaseLevDeque(DEQUE_CAPACITY));
+            stats[i] = {0, 0, 0};
+        }
+    }
+
+    ~WorkStealingPool() {
+        for (ChaseLevDeque* d : deques) {
+            delete d;
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Desde el worker que ejecuta la tarea actual, o antes de run()
+    void spawn(int worker, uint64_t task) {
+        if (!deques[worker]->push(task)) {
+            stats[worker].executed++;
+            fn(ctx, task, worker);
+        }
+    }
+
+    void finish() {
+        done.store(true, std::memory_order_release);
+    }
+
+    static void* worker_main(void* p) {
+        WorkerArgs* args = static_cast<WorkerArgs*>(p);
+        args->pool->work(args->id);
+        return nullptr;
+    }
+
+    void work(int id) {
+        WsWorkerStats& st = stats[id];
+        uint32_t rng = 2463534242u + id * 7919u;
+        int idle = 0;
+        uint64_t task;
+        while (!done.load(std::memory_order_acquire)) {
+            if (deques[id]->pop(&task)) {
+                st.executed++;
+                fn(ctx, task, id);
+                idle = 0;
+                continue;
+            }
+            // Una ronda de robo empezando por una victima al azar
+            bool stolen = false;
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            int first = rng % nworkers;
+            for (int k = 0; k < nworkers && !stolen; k++) {
+                int victim = (first + k) % nworkers;
+                if (victim != id && deques[victim]->steal(&task)) {
+                    stolen = true;
+                }
+            }
+            if (stolen) {
+                st.steals++;
+                st.executed++;
+                fn(ctx, task, id);
+                idle = 0;
+                continue;
+            }
+            st.failed_steals++;
+            if (++idle >= SPINS_BEFORE_YIELD) {
+                idle = 0;
+                sched_yield();
+            }
+        }
+    }
+
+    // Bloquea hasta que alguien llame finish()
+    void run() {
+        std::vector<pthread_t> threads(nworkers);
+        std::vector<WorkerArgs> args(nworkers);
+        for (int i = 0; i < nworkers; i++) {
+            args[i] = {this, i};
+            pthread_create(&threads[i], nullptr, worker_main, &args[i]);
+        }
+        for (pthread_t& th : threads) {
+            pthread_join(th, nullptr);
+        }
+    }
+
+    long total_steals() const {
+        long s = 0;
+        for (const WsWorkerStats& st : stats) {
+            s += st.steals;
+        }
+        return s;
+    }
+};
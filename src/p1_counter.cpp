@@ -11,6 +11,7 @@
 #include <ctime>
 #include <atomic>
 #include <cstdlib>
+#include "flat_combining.hpp"
 
 inline double now_s() {
     struct timespec ts;
@@ -20,12 +21,25 @@ inline double now_s() {
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
+// Operacion del contador para flat combining
+struct CounterOp {
+    long delta;
+};
+
+struct CounterApply {
+    long* counter;
+    void operator()(CounterOp& op) { *counter += op.delta; }
+};
+
+typedef FlatCombiner<CounterOp, CounterApply> CounterCombiner;
+
 struct Args {
     long iters;
     long* global;
     pthread_mutex_t* mtx;
     int thread_id;
     long* local_counter; // Para sharded approach
+    CounterCombiner* fc; // Para flat combining
 };
 
 void* worker_naive(void* p) {
@@ -46,6 +60,15 @@ void* worker_mutex(void* p) {
     return nullptr;
 }
 
+void* worker_fc(void* p) {
+    Args* a = static_cast<Args*>(p);
+    CounterOp op = {1};
+    for (long i = 0; i < a->iters; i++) {
+        a->fc->execute(a->thread_id, op);
+    }
+    return nullptr;
+}
+
 void* worker_sharded(void* p) {
     Args* a = static_cast<Args*>(p);
     for (long i = 0; i < a->iters; i++) {
@@ -70,6 +93,7 @@ void run_test(const char* name, void* (*worker)(void*), int T, long it, bool use
     std::vector<pthread_t> th(T);
     std::vector<long> local_counters(T, 0);
     std::vector<Args*> args_ptrs(T); // Para cleanup
+    CounterCombiner fc(T, CounterApply{&global});
     
     double start = now_s();
     
@@ -80,6 +104,7 @@ void run_test(const char* name, void* (*worker)(void*), int T, long it, bool use
         a->mtx = &mtx;
         a->thread_id = i;
         a->local_counter = local_counters.data();
+        a->fc = &fc;
         args_ptrs[i] = a;
         
         pthread_create(&th[i], nullptr, worker, a);
@@ -102,6 +127,9 @@ void run_test(const char* name, void* (*worker)(void*), int T, long it, bool use
     
     printf("%s: total=%ld (expected=%ld) time=%.3fs ops/sec=%.0f\n",
            name, actual, expected, end - start, expected / (end - start));
+    if (worker == worker_fc) {
+        printf("FC: %ld combiner turns, %.2f ops per turn\n", fc.combines, fc.avg_batch());
+    }
     
     // Cleanup
     for (int i = 0; i < T; i++) {
@@ -126,6 +154,9 @@ int main(int argc, char** argv) {
     printf("\n=== MUTEX PROTECTED ===\n");
     run_test("MUTEX", worker_mutex, T, it);
     
+    printf("\n=== FLAT COMBINING ===\n");
+    run_test("FC", worker_fc, T, it);
+    
     printf("\n=== SHARDED COUNTERS ===\n");
     run_test("SHARDED", worker_sharded, T, it);
     
@@ -11,6 +11,8 @@
 #include <ctime>
 #include <unistd.h>
 #include <vector>
+#include "hugepage.hpp"
+#include "perf_counter.hpp"
 
 inline double now_s() {
     struct timespec ts;
@@ -21,9 +23,11 @@ inline double now_s() {
 }
 
 const std::size_t Q = 1024;
+const long RING_MAX_CAPACITY = 1L << 26;   // 256 MiB de enteros
 
 struct Ring {
-    int buf[1024]; // Usar tamaño fijo en lugar de Q para compatibilidad
+    int* buf;          // cap enteros; con --hugepages respaldado por paginas de 2 MiB
+    std::size_t cap;
     std::size_t head;
     std::size_t tail;
     std::size_t count;
@@ -32,13 +36,15 @@ struct Ring {
     pthread_cond_t not_empty;
     bool stop;
     
-    Ring() : head(0), tail(0), count(0), stop(false) {
+    explicit Ring(std::size_t capacity = Q) : cap(capacity), head(0), tail(0), count(0), stop(false) {
+        buf = static_cast<int*>(huge_alloc(cap * sizeof(int)));
         pthread_mutex_init(&m, nullptr);
         pthread_cond_init(&not_full, nullptr);
         pthread_cond_init(&not_empty, nullptr);
     }
     
     ~Ring() {
+        huge_free(buf, cap * sizeof(int));
         pthread_mutex_destroy(&m);
         pthread_cond_destroy(&not_full);
         pthread_cond_destroy(&not_empty);
@@ -47,12 +53,12 @@ struct Ring {
 
 void ring_push(Ring* r, int v) {
     pthread_mutex_lock(&r->m);
-    while (r->count == Q && !r->stop) {
+    while (r->count == r->cap && !r->stop) {
         pthread_cond_wait(&r->not_full, &r->m);
     }
     if (!r->stop) {
         r->buf[r->head] = v;
-        r->head = (r->head + 1) % Q;
+        r->head = (r->head + 1) % r->cap;
         r->count++;
         pthread_cond_signal(&r->not_empty);
     }
@@ -69,7 +75,7 @@ bool ring_pop(Ring* r, int* out) {
         return false;
     }
     *out = r->buf[r->tail];
-    r->tail = (r->tail + 1) % Q;
+    r->tail = (r->tail + 1) % r->cap;
     r->count--;
     pthread_cond_signal(&r->not_full);
     pthread_mutex_unlock(&r->m);
@@ -135,14 +141,22 @@ void* consumer(void* p) {
 }
 
 int main(int argc, char** argv) {
+    argc = parse_hugepages_flag(argc, argv);
     int num_producers = (argc > 1) ? std::atoi(argv[1]) : 2;
     int num_consumers = (argc > 2) ? std::atoi(argv[2]) : 2;
     int items_per_producer = (argc > 3) ? std::atoi(argv[3]) : 10000;
+    long capacity_arg = (argc > 4) ? std::atol(argv[4]) : (long)Q;
+    if (capacity_arg < 1 || capacity_arg > RING_MAX_CAPACITY) {
+        printf("Capacity must be between 1 and %ld\n", RING_MAX_CAPACITY);
+        return 1;
+    }
+    std::size_t capacity = (std::size_t)capacity_arg;
     
-    printf("Testing with %d producers, %d consumers, %d items per producer\n",
-           num_producers, num_consumers, items_per_producer);
+    printf("Testing with %d producers, %d consumers, %d items per producer, capacity %zu\n",
+           num_producers, num_consumers, items_per_producer, capacity);
     
-    Ring ring;
+    Ring ring(capacity);
+    DtlbCounter dtlb;
     
     // Crear threads
     std::vector<pthread_t> producers(num_producers);
@@ -152,6 +166,7 @@ int main(int argc, char** argv) {
     std::vector<int> items_consumed(num_consumers, 0);
     
     double start = now_s();
+    dtlb.start();
     
     // Inicializar argumentos de productores
     for (int i = 0; i < num_producers; i++) {
@@ -194,6 +209,7 @@ int main(int argc, char** argv) {
     }
     
     double end = now_s();
+    long dtlb_misses = dtlb.stop();
     
     // Calcular totales
     int total_produced = num_producers * items_per_producer;
@@ -208,6 +224,12 @@ int main(int argc, char** argv) {
     printf("Items lost: %d\n", total_produced - total_consumed);
     printf("Time: %.3fs\n", end - start);
     printf("Throughput: %.0f items/sec\n", total_consumed / (end - start));
+    if (dtlb_misses >= 0) {
+        printf("dTLB misses: %ld\n", dtlb_misses);
+    } else {
+        printf("dTLB misses: n/a\n");
+    }
+    print_huge_stats();
     
     return 0;
 }
@@ -11,6 +11,23 @@
 #include <cstdlib>
 #include <ctime>
 #include <random>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <climits>
+#include <new>
+#include <sched.h>
+#include <type_traits>
+#include <malloc.h>
+#include "hugepage.hpp"
+#include "perf_counter.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 inline double now_s() {
     struct timespec ts;
@@ -22,6 +39,30 @@ inline double now_s() {
 
 const int NBUCKET = 1024;
 
+// Preferencia del rwlock. glibc por defecto prefiere lectores; con
+// PREFER_WRITER_NONRECURSIVE_NP un writer en espera bloquea lectores nuevos.
+enum RwPref {
+    RW_PREF_DEFAULT,
+    RW_PREF_READER,
+    RW_PREF_WRITER
+};
+
+static void rwlock_init_pref(pthread_rwlock_t* rw, RwPref pref) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    if (pref == RW_PREF_READER) {
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_READER_NP);
+    } else if (pref == RW_PREF_WRITER) {
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    }
+#else
+    (void)pref; // Sin _np fuera de glibc: se usa la preferencia del sistema
+#endif
+    pthread_rwlock_init(rw, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
 struct Node {
     int k, v;
     Node* next;
@@ -29,18 +70,18 @@ struct Node {
 };
 
 struct MapRW {
-    Node* b[1024]; // Usar tamaño fijo
+    Node** b;    // nbucket cabezas; NBUCKET salvo para mapas de millones de keys
+    int nbucket;
     pthread_rwlock_t rw;
     
-    MapRW() {
-        for (int i = 0; i < NBUCKET; i++) {
-            b[i] = nullptr;
-        }
-        pthread_rwlock_init(&rw, nullptr);
+    explicit MapRW(RwPref pref = RW_PREF_DEFAULT, int buckets = NBUCKET) : nbucket(buckets) {
+        // huge_alloc entrega memoria en cero: todas las cabezas quedan en nullptr
+        b = static_cast<Node**>(huge_alloc(nbucket * sizeof(Node*)));
+        rwlock_init_pref(&rw, pref);
     }
     
     ~MapRW() {
-        for (int i = 0; i < NBUCKET; i++) {
+        for (int i = 0; i < nbucket; i++) {
             Node* curr = b[i];
             while (curr) {
                 Node* next = curr->next;
@@ -48,11 +89,15 @@ struct MapRW {
                 curr = next;
             }
         }
+        huge_free(b, nbucket * sizeof(Node*));
         pthread_rwlock_destroy(&rw);
     }
     
+    MapRW(const MapRW&) = delete;
+    MapRW& operator=(const MapRW&) = delete;
+    
     int hash(int k) const {
-        return ((unsigned int)k) % NBUCKET;
+        return ((unsigned int)k) % nbucket;
     }
 };
 
@@ -84,6 +129,84 @@ struct MapMutex {
     }
 };
 
+// "Big reader" lock: un mutex por slot, cada uno en su propia linea de cache.
+// Un lector solo toma el mutex de su slot, asi que lectores en distintos
+// slots no comparten ninguna linea; un writer barre todos los slots en orden.
+const int BR_SLOTS = 64;
+
+struct alignas(64) BrSlot {
+    pthread_mutex_t m;
+};
+
+struct BrLock {
+    BrSlot slot[BR_SLOTS];
+    
+    BrLock() {
+        for (int i = 0; i < BR_SLOTS; i++) {
+            pthread_mutex_init(&slot[i].m, nullptr);
+        }
+    }
+    
+    ~BrLock() {
+        for (int i = 0; i < BR_SLOTS; i++) {
+            pthread_mutex_destroy(&slot[i].m);
+        }
+    }
+};
+
+// Slot del thread actual, asignado round-robin la primera vez que lee
+static int br_my_slot() {
+    static std::atomic<int> next_slot(0);
+    static thread_local int slot = next_slot.fetch_add(1) % BR_SLOTS;
+    return slot;
+}
+
+static void br_read_lock(BrLock* l) {
+    pthread_mutex_lock(&l->slot[br_my_slot()].m);
+}
+
+static void br_read_unlock(BrLock* l) {
+    pthread_mutex_unlock(&l->slot[br_my_slot()].m);
+}
+
+static void br_write_lock(BrLock* l) {
+    for (int i = 0; i < BR_SLOTS; i++) {
+        pthread_mutex_lock(&l->slot[i].m);
+    }
+}
+
+static void br_write_unlock(BrLock* l) {
+    for (int i = BR_SLOTS - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&l->slot[i].m);
+    }
+}
+
+struct MapBR {
+    Node* b[1024]; // Usar tamaño fijo
+    BrLock br;
+    
+    MapBR() {
+        for (int i = 0; i < NBUCKET; i++) {
+            b[i] = nullptr;
+        }
+    }
+    
+    ~MapBR() {
+        for (int i = 0; i < NBUCKET; i++) {
+            Node* curr = b[i];
+            while (curr) {
+                Node* next = curr->next;
+                delete curr;
+                curr = next;
+            }
+        }
+    }
+    
+    int hash(int k) const {
+        return ((unsigned int)k) % NBUCKET;
+    }
+};
+
 int map_get_rw(MapRW* m, int k) {
     pthread_rwlock_rdlock(&m->rw);
     
@@ -170,160 +293,1654 @@ void map_put_mutex(MapMutex* m, int k, int v) {
     pthread_mutex_unlock(&m->m);
 }
 
-struct WorkerArgsRW {
-    MapRW* map;
-    int operations;
-    int read_percentage;
-    int thread_id;
-    int* ops_completed;
-};
-
-struct WorkerArgsMutex {
-    MapMutex* map;
-    int operations;
-    int read_percentage;
-    int thread_id;
-    int* ops_completed;
-};
+int map_get_br(MapBR* m, int k) {
+    br_read_lock(&m->br);
+    
+    int bucket = m->hash(k);
+    Node* curr = m->b[bucket];
+    int result = -1;
+    
+    while (curr) {
+        if (curr->k == k) {
+            result = curr->v;
+            break;
+        }
+        curr = curr->next;
+    }
+    
+    br_read_unlock(&m->br);
+    return result;
+}
 
-void* worker_rw(void* p) {
-    WorkerArgsRW* args = static_cast<WorkerArgsRW*>(p);
-    std::mt19937 gen(args->thread_id);
-    std::uniform_int_distribution<> dis(0, 99);
-    std::uniform_int_distribution<> key_dis(0, 9999);
+void map_put_br(MapBR* m, int k, int v) {
+    br_write_lock(&m->br);
     
-    int completed = 0;
+    int bucket = m->hash(k);
+    Node* curr = m->b[bucket];
     
-    for (int i = 0; i < args->operations; i++) {
-        int key = key_dis(gen);
-        
-        if (dis(gen) < args->read_percentage) {
-            // Operación de lectura
-            map_get_rw(args->map, key);
-        } else {
-            // Operación de escritura
-            map_put_rw(args->map, key, key * 2);
+    // Verificar si la key existe
+    while (curr) {
+        if (curr->k == k) {
+            curr->v = v;
+            br_write_unlock(&m->br);
+            return;
         }
-        completed++;
+        curr = curr->next;
     }
     
-    *args->ops_completed = completed;
-    return nullptr;
+    // Insertar nuevo nodo al inicio
+    Node* new_node = new Node(k, v);
+    new_node->next = m->b[bucket];
+    m->b[bucket] = new_node;
+    
+    br_write_unlock(&m->br);
 }
 
-void* worker_mutex(void* p) {
-    WorkerArgsMutex* args = static_cast<WorkerArgsMutex*>(p);
-    std::mt19937 gen(args->thread_id);
-    std::uniform_int_distribution<> dis(0, 99);
-    std::uniform_int_distribution<> key_dis(0, 9999);
+// ---------------------------------------------------------------------------
+// Skip list concurrente (mapa ordenado con scans por rango)
+// ---------------------------------------------------------------------------
+//
+// Lecturas y scans sin locks: recorren punteros atomicos con acquire. Las
+// inserciones usan locks por nodo al estilo lazy skip list: se bloquean los
+// predecesores de cada nivel, se valida que sigan apuntando al sucesor visto
+// y se enlaza de abajo hacia arriba. No hay borrado, asi que un nodo nunca se
+// libera mientras el mapa vive y los lectores no necesitan reclamacion.
+
+const int SKIP_MAX_LEVEL = 20;
+
+struct SkipNode {
+    int k;
+    std::atomic<int> v;
+    int top_level;
+    std::atomic<bool> fully_linked;
+    pthread_mutex_t lock;
+    std::atomic<SkipNode*> next[1];  // En realidad top_level + 1 entradas
     
-    int completed = 0;
+    static SkipNode* create(int key, int val, int top) {
+        size_t bytes = sizeof(SkipNode) + top * sizeof(std::atomic<SkipNode*>);
+        SkipNode* n = static_cast<SkipNode*>(::operator new(bytes));
+        n->k = key;
+        new (&n->v) std::atomic<int>(val);
+        n->top_level = top;
+        new (&n->fully_linked) std::atomic<bool>(false);
+        pthread_mutex_init(&n->lock, nullptr);
+        for (int i = 0; i <= top; i++) {
+            new (&n->next[i]) std::atomic<SkipNode*>(nullptr);
+        }
+        return n;
+    }
     
-    for (int i = 0; i < args->operations; i++) {
-        int key = key_dis(gen);
-        
-        if (dis(gen) < args->read_percentage) {
-            // Operación de lectura
-            map_get_mutex(args->map, key);
-        } else {
-            // Operación de escritura
-            map_put_mutex(args->map, key, key * 2);
+    static void destroy(SkipNode* n) {
+        pthread_mutex_destroy(&n->lock);
+        ::operator delete(n);
+    }
+};
+
+struct SkipList {
+    SkipNode* head;  // Centinela con key INT_MIN y todos los niveles
+    
+    SkipList() {
+        head = SkipNode::create(INT_MIN, 0, SKIP_MAX_LEVEL - 1);
+        head->fully_linked.store(true);
+    }
+    
+    ~SkipList() {
+        SkipNode* curr = head;
+        while (curr) {
+            SkipNode* next = curr->next[0].load(std::memory_order_relaxed);
+            SkipNode::destroy(curr);
+            curr = next;
         }
-        completed++;
     }
     
-    *args->ops_completed = completed;
-    return nullptr;
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+};
+
+// Nivel geometrico con p = 1/2 usando un xorshift por thread
+static int skip_random_level() {
+    static thread_local uint32_t state = 0;
+    if (state == 0) {
+        state = (uint32_t)(uintptr_t)&state | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    int level = __builtin_ctz(state | (1u << (SKIP_MAX_LEVEL - 1)));
+    return level;
 }
 
-void test_scenario(const char* name, int num_threads, int ops_per_thread, int read_percentage) {
-    printf("\n=== %s (Threads: %d, Ops: %d, Reads: %d%%) ===\n", 
-           name, num_threads, ops_per_thread, read_percentage);
+// Llena preds/succs por nivel y devuelve el nivel mas alto donde aparece k,
+// o -1 si no esta. Sin locks.
+static int skip_find(SkipList* l, int k, SkipNode** preds, SkipNode** succs) {
+    int found = -1;
+    SkipNode* pred = l->head;
+    for (int lev = SKIP_MAX_LEVEL - 1; lev >= 0; lev--) {
+        SkipNode* curr = pred->next[lev].load(std::memory_order_acquire);
+        while (curr && curr->k < k) {
+            pred = curr;
+            curr = pred->next[lev].load(std::memory_order_acquire);
+        }
+        if (found == -1 && curr && curr->k == k) {
+            found = lev;
+        }
+        preds[lev] = pred;
+        succs[lev] = curr;
+    }
+    return found;
+}
+
+int skip_get(SkipList* l, int k) {
+    SkipNode* pred = l->head;
+    SkipNode* curr = nullptr;
+    for (int lev = SKIP_MAX_LEVEL - 1; lev >= 0; lev--) {
+        curr = pred->next[lev].load(std::memory_order_acquire);
+        while (curr && curr->k < k) {
+            pred = curr;
+            curr = pred->next[lev].load(std::memory_order_acquire);
+        }
+        if (curr && curr->k == k) {
+            return curr->v.load(std::memory_order_acquire);
+        }
+    }
+    return -1;
+}
+
+void skip_put(SkipList* l, int k, int v) {
+    SkipNode* preds[SKIP_MAX_LEVEL];
+    SkipNode* succs[SKIP_MAX_LEVEL];
+    int top = skip_random_level();
     
-    // Test con rwlock
-    {
-        MapRW map_rw;
-        std::vector<pthread_t> threads(num_threads);
-        std::vector<WorkerArgsRW> args(num_threads);
-        std::vector<int> ops_completed(num_threads);
-        
-        // Inicializar argumentos
-        for (int i = 0; i < num_threads; i++) {
-            args[i].map = &map_rw;
-            args[i].operations = ops_per_thread;
-            args[i].read_percentage = read_percentage;
-            args[i].thread_id = i;
-            args[i].ops_completed = &ops_completed[i];
+    while (true) {
+        int found = skip_find(l, k, preds, succs);
+        if (found != -1) {
+            // Ya existe: esperar a que termine de enlazarse y actualizar
+            SkipNode* n = succs[found];
+            while (!n->fully_linked.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            n->v.store(v, std::memory_order_release);
+            return;
         }
         
-        double start = now_s();
-        
-        for (int i = 0; i < num_threads; i++) {
-            pthread_create(&threads[i], nullptr, worker_rw, &args[i]);
+        // Bloquear predecesores de abajo hacia arriba y validar
+        int highest_locked = -1;
+        bool valid = true;
+        SkipNode* prev = nullptr;
+        for (int lev = 0; valid && lev <= top; lev++) {
+            SkipNode* pred = preds[lev];
+            if (pred != prev) {
+                pthread_mutex_lock(&pred->lock);
+                prev = pred;
+            }
+            highest_locked = lev;
+            valid = pred->next[lev].load(std::memory_order_acquire) == succs[lev];
         }
         
-        for (int i = 0; i < num_threads; i++) {
-            pthread_join(threads[i], nullptr);
+        if (valid) {
+            SkipNode* n = SkipNode::create(k, v, top);
+            for (int lev = 0; lev <= top; lev++) {
+                n->next[lev].store(succs[lev], std::memory_order_relaxed);
+            }
+            for (int lev = 0; lev <= top; lev++) {
+                preds[lev]->next[lev].store(n, std::memory_order_release);
+            }
+            n->fully_linked.store(true, std::memory_order_release);
         }
         
-        double end = now_s();
-        
-        int total_ops = 0;
-        for (int i = 0; i < num_threads; i++) {
-            total_ops += ops_completed[i];
+        prev = nullptr;
+        for (int lev = 0; lev <= highest_locked; lev++) {
+            if (preds[lev] != prev) {
+                pthread_mutex_unlock(&preds[lev]->lock);
+                prev = preds[lev];
+            }
         }
         
-        printf("RWLOCK: %.3fs, %.0f ops/sec\n", 
-               end - start, total_ops / (end - start));
+        if (valid) {
+            return;
+        }
+    }
+}
+
+// Copia hasta count pares con key >= from, en orden. Devuelve cuantos copio.
+// No es un corte atomico: inserciones concurrentes pueden o no aparecer.
+int skip_scan(SkipList* l, int from, int count, int* keys, int* vals) {
+    SkipNode* pred = l->head;
+    for (int lev = SKIP_MAX_LEVEL - 1; lev >= 0; lev--) {
+        SkipNode* curr = pred->next[lev].load(std::memory_order_acquire);
+        while (curr && curr->k < from) {
+            pred = curr;
+            curr = pred->next[lev].load(std::memory_order_acquire);
+        }
     }
     
-    // Test con mutex
-    {
-        MapMutex map_mutex;
-        std::vector<pthread_t> threads(num_threads);
-        std::vector<WorkerArgsMutex> args(num_threads);
-        std::vector<int> ops_completed(num_threads);
-        
-        // Inicializar argumentos
-        for (int i = 0; i < num_threads; i++) {
-            args[i].map = &map_mutex;
-            args[i].operations = ops_per_thread;
-            args[i].read_percentage = read_percentage;
-            args[i].thread_id = i;
-            args[i].ops_completed = &ops_completed[i];
+    int n = 0;
+    SkipNode* curr = pred->next[0].load(std::memory_order_acquire);
+    while (curr && n < count) {
+        keys[n] = curr->k;
+        vals[n] = curr->v.load(std::memory_order_acquire);
+        n++;
+        curr = curr->next[0].load(std::memory_order_acquire);
+    }
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Mapa compacto: nodos en un pool contiguo enlazados por indice de 32 bits
+// ---------------------------------------------------------------------------
+//
+// Cada entrada ocupa 12 bytes (k, v, next) sin header de malloc. La primera
+// entrada de cada bucket vive dentro del arreglo de buckets; las colisiones van
+// a un pool dividido en chunks de COMPACT_CHUNK_BYTES que nunca se mueven: un
+// indice visto por un lector sigue siendo valido aunque otro stripe haga
+// crecer el pool en paralelo. El directorio de chunks se reserva completo al
+// crear el mapa, asi que crecer solo publica un puntero nuevo.
+
+const uint32_t COMPACT_NIL = 0;            // Fin de cadena (indice 0 del pool no se usa)
+const uint32_t COMPACT_EMPTY = UINT32_MAX; // Bucket sin entradas
+const int COMPACT_STRIPES = 64;
+const size_t COMPACT_CHUNK_BYTES = 2 << 20;
+
+struct CompactEntry {
+    int k;
+    int v;
+    uint32_t next;
+};
+
+const uint32_t COMPACT_CHUNK_ENTRIES = COMPACT_CHUNK_BYTES / sizeof(CompactEntry);
+const uint32_t COMPACT_MAX_CHUNKS = UINT32_MAX / COMPACT_CHUNK_ENTRIES + 1;
+
+struct alignas(64) CompactStripe {
+    pthread_rwlock_t rw;
+};
+
+struct CompactMap {
+    CompactEntry* b;       // Entrada inline por bucket; next == COMPACT_EMPTY si vacio
+    int nbucket;
+    CompactStripe stripes[COMPACT_STRIPES];
+    std::atomic<CompactEntry*>* chunks;
+    std::atomic<uint32_t> pool_next;
+    pthread_mutex_t grow_mutex;
+    
+    explicit CompactMap(int buckets = NBUCKET) : nbucket(buckets), pool_next(1) {
+        b = static_cast<CompactEntry*>(huge_alloc(nbucket * sizeof(CompactEntry)));
+        for (int i = 0; i < nbucket; i++) {
+            b[i].next = COMPACT_EMPTY;
         }
-        
-        double start = now_s();
-        
-        for (int i = 0; i < num_threads; i++) {
-            pthread_create(&threads[i], nullptr, worker_mutex, &args[i]);
+        for (int i = 0; i < COMPACT_STRIPES; i++) {
+            pthread_rwlock_init(&stripes[i].rw, nullptr);
+        }
+        chunks = new std::atomic<CompactEntry*>[COMPACT_MAX_CHUNKS];
+        for (uint32_t i = 0; i < COMPACT_MAX_CHUNKS; i++) {
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+        pthread_mutex_init(&grow_mutex, nullptr);
+    }
+    
+    ~CompactMap() {
+        for (uint32_t i = 0; i < COMPACT_MAX_CHUNKS; i++) {
+            huge_free(chunks[i].load(), COMPACT_CHUNK_BYTES);
+        }
+        delete[] chunks;
+        huge_free(b, nbucket * sizeof(CompactEntry));
+        for (int i = 0; i < COMPACT_STRIPES; i++) {
+            pthread_rwlock_destroy(&stripes[i].rw);
+        }
+        pthread_mutex_destroy(&grow_mutex);
+    }
+    
+    CompactMap(const CompactMap&) = delete;
+    CompactMap& operator=(const CompactMap&) = delete;
+    
+    int hash(int k) const {
+        return ((unsigned int)k) % nbucket;
+    }
+    
+    pthread_rwlock_t* stripe_for(int bucket) {
+        return &stripes[bucket % COMPACT_STRIPES].rw;
+    }
+    
+    CompactEntry* entry(uint32_t idx) const {
+        return &chunks[idx / COMPACT_CHUNK_ENTRIES].load(std::memory_order_acquire)[idx % COMPACT_CHUNK_ENTRIES];
+    }
+    
+    // Bytes reservados por el mapa: buckets + directorio + chunks del pool
+    size_t bytes_used() const {
+        uint32_t used_chunks = (pool_next.load() + COMPACT_CHUNK_ENTRIES - 1) / COMPACT_CHUNK_ENTRIES;
+        return sizeof(CompactMap) + (size_t)nbucket * sizeof(CompactEntry) +
+               COMPACT_MAX_CHUNKS * sizeof(std::atomic<CompactEntry*>) +
+               (size_t)used_chunks * COMPACT_CHUNK_BYTES;
+    }
+};
+
+// Reserva una entrada del pool; crea el chunk si es la primera que cae en el
+static uint32_t compact_alloc(CompactMap* m) {
+    uint32_t idx = m->pool_next.fetch_add(1, std::memory_order_relaxed);
+    uint32_t c = idx / COMPACT_CHUNK_ENTRIES;
+    
+    if (!m->chunks[c].load(std::memory_order_acquire)) {
+        pthread_mutex_lock(&m->grow_mutex);
+        if (!m->chunks[c].load(std::memory_order_relaxed)) {
+            // Un chunk es exactamente una pagina de 2 MiB con --hugepages
+            void* chunk = huge_alloc(COMPACT_CHUNK_BYTES);
+            m->chunks[c].store(static_cast<CompactEntry*>(chunk), std::memory_order_release);
+        }
+        pthread_mutex_unlock(&m->grow_mutex);
+    }
+    return idx;
+}
+
+int compact_get(CompactMap* m, int k) {
+    int bucket = m->hash(k);
+    pthread_rwlock_t* rw = m->stripe_for(bucket);
+    pthread_rwlock_rdlock(rw);
+    
+    const CompactEntry* head = &m->b[bucket];
+    int result = -1;
+    
+    if (head->next != COMPACT_EMPTY) {
+        if (head->k == k) {
+            result = head->v;
+        } else {
+            uint32_t idx = head->next;
+            while (idx != COMPACT_NIL) {
+                const CompactEntry* e = m->entry(idx);
+                if (e->k == k) {
+                    result = e->v;
+                    break;
+                }
+                idx = e->next;
+            }
+        }
+    }
+    
+    pthread_rwlock_unlock(rw);
+    return result;
+}
+
+void compact_put(CompactMap* m, int k, int v) {
+    int bucket = m->hash(k);
+    pthread_rwlock_t* rw = m->stripe_for(bucket);
+    pthread_rwlock_wrlock(rw);
+    
+    CompactEntry* head = &m->b[bucket];
+    
+    if (head->next == COMPACT_EMPTY) {
+        // Bucket vacio: la entrada queda inline
+        head->k = k;
+        head->v = v;
+        head->next = COMPACT_NIL;
+    } else if (head->k == k) {
+        head->v = v;
+    } else {
+        uint32_t idx = head->next;
+        while (idx != COMPACT_NIL) {
+            CompactEntry* e = m->entry(idx);
+            if (e->k == k) {
+                e->v = v;
+                pthread_rwlock_unlock(rw);
+                return;
+            }
+            idx = e->next;
         }
         
-        for (int i = 0; i < num_threads; i++) {
-            pthread_join(threads[i], nullptr);
+        // Insertar detras de la entrada inline
+        uint32_t n = compact_alloc(m);
+        CompactEntry* e = m->entry(n);
+        e->k = k;
+        e->v = v;
+        e->next = head->next;
+        head->next = n;
+    }
+    
+    pthread_rwlock_unlock(rw);
+}
+
+// Sobrecargas para que los workers genericos elijan la variante por tipo
+inline int map_get(MapRW* m, int k) { return map_get_rw(m, k); }
+inline int map_get(MapMutex* m, int k) { return map_get_mutex(m, k); }
+inline int map_get(MapBR* m, int k) { return map_get_br(m, k); }
+inline int map_get(SkipList* m, int k) { return skip_get(m, k); }
+inline int map_get(CompactMap* m, int k) { return compact_get(m, k); }
+inline void map_put(MapRW* m, int k, int v) { map_put_rw(m, k, v); }
+inline void map_put(MapMutex* m, int k, int v) { map_put_mutex(m, k, v); }
+inline void map_put(MapBR* m, int k, int v) { map_put_br(m, k, v); }
+inline void map_put(SkipList* m, int k, int v) { skip_put(m, k, v); }
+inline void map_put(CompactMap* m, int k, int v) { compact_put(m, k, v); }
+
+// Distancia (en keys) con la que se hace prefetch de la cabeza de bucket
+const int PREFETCH_DIST = 8;
+
+// Agrupamiento por stripe: el bucket array se divide en BATCH_STRIPES franjas
+// contiguas y un counting sort estable reparte el lote por franja en O(n).
+// Un std::sort completo por bucket cuesta mas que lo que ahorra con 1024
+// buckets; con stripes las keys vecinas caen en la misma zona del arreglo y
+// dos puts a la misma key conservan el orden del llamador.
+const int BATCH_STRIPES = 16;
+
+static void group_by_stripe(const MapRW* m, const int* keys, int n,
+                            std::vector<int>& buckets, std::vector<int>& order) {
+    int count[BATCH_STRIPES + 1] = {0};
+    buckets.resize(n);
+    order.resize(n);
+    
+    for (int i = 0; i < n; i++) {
+        buckets[i] = m->hash(keys[i]);
+        count[(long)buckets[i] * BATCH_STRIPES / m->nbucket + 1]++;
+    }
+    for (int s = 0; s < BATCH_STRIPES; s++) {
+        count[s + 1] += count[s];
+    }
+    for (int i = 0; i < n; i++) {
+        order[count[(long)buckets[i] * BATCH_STRIPES / m->nbucket]++] = i;
+    }
+}
+
+// Lookup por lotes: agrupa las keys por stripe fuera del lock, toma el rdlock
+// una sola vez para todo el lote y hace prefetch de las cabezas de bucket
+// PREFETCH_DIST posiciones antes de recorrer cada cadena.
+void map_get_many(MapRW* m, const int* keys, int* out, int n) {
+    static thread_local std::vector<int> buckets, order;
+    group_by_stripe(m, keys, n, buckets, order);
+    
+    pthread_rwlock_rdlock(&m->rw);
+    
+    for (int i = 0; i < n; i++) {
+        if (i + PREFETCH_DIST < n) {
+            __builtin_prefetch(m->b[buckets[order[i + PREFETCH_DIST]]]);
         }
         
-        double end = now_s();
+        int idx = order[i];
+        int bucket = buckets[idx];
+        int k = keys[idx];
+        Node* curr = m->b[bucket];
+        int result = -1;
         
-        int total_ops = 0;
-        for (int i = 0; i < num_threads; i++) {
-            total_ops += ops_completed[i];
+        while (curr) {
+            if (curr->k == k) {
+                result = curr->v;
+                break;
+            }
+            curr = curr->next;
         }
-        
-        printf("MUTEX:  %.3fs, %.0f ops/sec\n", 
-               end - start, total_ops / (end - start));
+        out[idx] = result;
     }
+    
+    pthread_rwlock_unlock(&m->rw);
 }
 
-int main(int argc, char** argv) {
-    int num_threads = (argc > 1) ? std::atoi(argv[1]) : 4;
-    int ops_per_thread = (argc > 2) ? std::atoi(argv[2]) : 100000;
+// Escritura por lotes: mismo agrupamiento que map_get_many, con un solo wrlock
+void map_put_many(MapRW* m, const int* keys, const int* vals, int n) {
+    static thread_local std::vector<int> buckets, order;
+    group_by_stripe(m, keys, n, buckets, order);
     
-    printf("Readers/Writers Performance Comparison\n");
+    pthread_rwlock_wrlock(&m->rw);
     
-    test_scenario("90/10 Read/Write", num_threads, ops_per_thread, 90);
-    test_scenario("70/30 Read/Write", num_threads, ops_per_thread, 70);
-    test_scenario("50/50 Read/Write", num_threads, ops_per_thread, 50);
+    for (int i = 0; i < n; i++) {
+        if (i + PREFETCH_DIST < n) {
+            __builtin_prefetch(m->b[buckets[order[i + PREFETCH_DIST]]]);
+        }
+        
+        int idx = order[i];
+        int bucket = buckets[idx];
+        int k = keys[idx];
+        Node* curr = m->b[bucket];
+        
+        while (curr && curr->k != k) {
+            curr = curr->next;
+        }
+        
+        if (curr) {
+            curr->v = vals[idx];
+        } else {
+            Node* new_node = new Node(k, vals[idx]);
+            new_node->next = m->b[bucket];
+            m->b[bucket] = new_node;
+        }
+    }
+    
+    pthread_rwlock_unlock(&m->rw);
+}
+
+template <typename Map>
+struct WorkerArgs {
+    Map* map;
+    int operations;
+    int read_percentage;
+    int scan_percentage;  // Solo mapas ordenados (SkipList)
+    int thread_id;
+    int* ops_completed;
+    int* reads_completed;
+    int* scans_completed;
+    std::vector<double>* write_wait;  // Latencia de cada put (s)
+    long checksum;
+};
+
+const int SCAN_LEN = 50;
+
+template <typename Map>
+void* worker_map(void* p) {
+    WorkerArgs<Map>* args = static_cast<WorkerArgs<Map>*>(p);
+    std::mt19937 gen(args->thread_id);
+    std::uniform_int_distribution<> dis(0, 99);
+    std::uniform_int_distribution<> key_dis(0, 9999);
+    
+    int completed = 0;
+    int reads = 0;
+    int scans = 0;
+    long checksum = 0;
+    int scan_keys[SCAN_LEN], scan_vals[SCAN_LEN];
+    
+    for (int i = 0; i < args->operations; i++) {
+        int key = key_dis(gen);
+        int op = dis(gen);
+        
+        if (op < args->read_percentage) {
+            // Operación de lectura
+            checksum += map_get(args->map, key);
+            reads++;
+        } else if (op < args->read_percentage + args->scan_percentage) {
+            // Scan por rango (solo existe para mapas ordenados)
+            if constexpr (std::is_same<Map, SkipList>::value) {
+                checksum += skip_scan(args->map, key, SCAN_LEN, scan_keys, scan_vals);
+            }
+            scans++;
+        } else {
+            // Operación de escritura
+            double t0 = now_s();
+            map_put(args->map, key, key * 2);
+            args->write_wait->push_back(now_s() - t0);
+        }
+        completed++;
+    }
+    
+    *args->ops_completed = completed;
+    *args->reads_completed = reads;
+    *args->scans_completed = scans;
+    args->checksum = checksum;
+    return nullptr;
+}
+
+// Corre num_threads workers sobre un mapa e imprime throughput total,
+// throughput de lecturas y p99 de la espera de los writers
+template <typename Map>
+void run_variant(const char* label, Map* map, int num_threads, int ops_per_thread,
+                 int read_percentage, int scan_percentage = 0) {
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<WorkerArgs<Map>> args(num_threads);
+    std::vector<int> ops_completed(num_threads);
+    std::vector<int> reads_completed(num_threads);
+    std::vector<int> scans_completed(num_threads);
+    std::vector<std::vector<double>> write_wait(num_threads);
+    
+    // Inicializar argumentos
+    for (int i = 0; i < num_threads; i++) {
+        write_wait[i].reserve(ops_per_thread * (100 - read_percentage) / 100 + 16);
+        args[i].map = map;
+        args[i].operations = ops_per_thread;
+        args[i].read_percentage = read_percentage;
+        args[i].scan_percentage = scan_percentage;
+        args[i].thread_id = i;
+        args[i].ops_completed = &ops_completed[i];
+        args[i].reads_completed = &reads_completed[i];
+        args[i].scans_completed = &scans_completed[i];
+        args[i].write_wait = &write_wait[i];
+        args[i].checksum = 0;
+    }
+    
+    double start = now_s();
+    
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], nullptr, worker_map<Map>, &args[i]);
+    }
+    
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    
+    double end = now_s();
+    
+    int total_ops = 0;
+    int total_reads = 0;
+    int total_scans = 0;
+    std::vector<double> waits;
+    for (int i = 0; i < num_threads; i++) {
+        total_ops += ops_completed[i];
+        total_reads += reads_completed[i];
+        total_scans += scans_completed[i];
+        waits.insert(waits.end(), write_wait[i].begin(), write_wait[i].end());
+    }
+    
+    double p99_us = 0;
+    if (!waits.empty()) {
+        size_t idx = waits.size() * 99 / 100;
+        std::nth_element(waits.begin(), waits.begin() + idx, waits.end());
+        p99_us = waits[idx] * 1e6;
+    }
+    
+    printf("%-10s %.3fs, %.0f ops/sec, %.0f reads/sec, write p99 %.1fus",
+           label, end - start, total_ops / (end - start),
+           total_reads / (end - start), p99_us);
+    if (scan_percentage > 0) {
+        printf(", %.0f scans/sec", total_scans / (end - start));
+    }
+    printf("\n");
+}
+
+void test_scenario(const char* name, int num_threads, int ops_per_thread, int read_percentage) {
+    printf("\n=== %s (Threads: %d, Ops: %d, Reads: %d%%) ===\n", 
+           name, num_threads, ops_per_thread, read_percentage);
+    
+    // Test con rwlock (preferencia por defecto de la libc)
+    {
+        MapRW map_rw;
+        run_variant("RWLOCK:", &map_rw, num_threads, ops_per_thread, read_percentage);
+    }
+    
+    // rwlock con preferencia explicita por lectores / por escritores
+    {
+        MapRW map_rw(RW_PREF_READER);
+        run_variant("RW-READ:", &map_rw, num_threads, ops_per_thread, read_percentage);
+    }
+    {
+        MapRW map_rw(RW_PREF_WRITER);
+        run_variant("RW-WRITE:", &map_rw, num_threads, ops_per_thread, read_percentage);
+    }
+    
+    // Test con mutex
+    {
+        MapMutex map_mutex;
+        run_variant("MUTEX:", &map_mutex, num_threads, ops_per_thread, read_percentage);
+    }
+    
+    // Big reader lock por slot
+    {
+        MapBR map_br;
+        run_variant("BRLOCK:", &map_br, num_threads, ops_per_thread, read_percentage);
+    }
+    
+    // Skip list: lecturas sin locks, locks por nodo al insertar
+    {
+        SkipList skip;
+        run_variant("SKIPLIST:", &skip, num_threads, ops_per_thread, read_percentage);
+    }
+    
+    // Mapa compacto con pool de indices de 32 bits y locks por stripe
+    {
+        CompactMap compact;
+        run_variant("COMPACT:", &compact, num_threads, ops_per_thread, read_percentage);
+    }
+}
+
+// Mezcla con scans por rango: solo el mapa ordenado puede servirla, asi que
+// se compara contra MapRW haciendo el mismo porcentaje como lecturas puntuales
+void test_scan_scenario(const char* name, int num_threads, int ops_per_thread,
+                        int read_percentage, int scan_percentage) {
+    printf("\n=== %s (Threads: %d, Ops: %d, Reads: %d%%, Scans(%d): %d%%) ===\n",
+           name, num_threads, ops_per_thread, read_percentage, SCAN_LEN, scan_percentage);
+    
+    {
+        SkipList skip;
+        run_variant("SKIPLIST:", &skip, num_threads, ops_per_thread,
+                    read_percentage, scan_percentage);
+    }
+    {
+        MapRW map_rw;
+        run_variant("RWLOCK:", &map_rw, num_threads, ops_per_thread,
+                    read_percentage + scan_percentage);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Snapshot en disco y warm-start con mmap
+// ---------------------------------------------------------------------------
+//
+// Formato (sin punteros, little-endian nativo):
+//   SnapshotHeader
+//   SnapEntry entries[count]          agrupadas por bucket, en orden de cadena
+//   uint32_t offsets[nbucket + 1]     entries de bucket i: [offsets[i], offsets[i+1])
+//
+// La tabla de offsets va al final porque el conteo solo se conoce al terminar
+// de recorrer el mapa; el header se reescribe con pwrite al cerrar.
+
+const char SNAP_MAGIC[8] = {'P', '3', 'S', 'N', 'A', 'P', '0', '1'};
+const int SNAP_CHUNK = 256;  // Buckets copiados por cada rdlock
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t nbucket;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t offsets_pos;  // Posicion en bytes de la tabla de offsets
+};
+
+struct SnapEntry {
+    int32_t k;
+    int32_t v;
+};
+
+// Escribe el mapa en path. Cada bloque de SNAP_CHUNK buckets se copia bajo
+// un rdlock propio: los lectores nunca esperan y un writer espera como mucho
+// la copia de un bloque. El resultado es consistente por bucket, no un corte
+// global (puts concurrentes pueden caer antes o despues de su bloque).
+bool snapshot_write(MapRW* m, const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("snapshot_write: open");
+        return false;
+    }
+    
+    SnapshotHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    bool ok = pwrite(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr);
+    
+    std::vector<uint32_t> offsets(m->nbucket + 1, 0);
+    std::vector<SnapEntry> chunk;
+    uint64_t count = 0;
+    off_t pos = sizeof(hdr);
+    
+    for (int first = 0; ok && first < m->nbucket; first += SNAP_CHUNK) {
+        int last = std::min(first + SNAP_CHUNK, m->nbucket);
+        chunk.clear();
+        
+        pthread_rwlock_rdlock(&m->rw);
+        for (int i = first; i < last; i++) {
+            offsets[i] = count + chunk.size();
+            for (Node* curr = m->b[i]; curr; curr = curr->next) {
+                chunk.push_back(SnapEntry{curr->k, curr->v});
+            }
+        }
+        pthread_rwlock_unlock(&m->rw);
+        
+        // La escritura a disco ocurre fuera del lock
+        size_t bytes = chunk.size() * sizeof(SnapEntry);
+        ok = bytes == 0 || pwrite(fd, chunk.data(), bytes, pos) == (ssize_t)bytes;
+        pos += bytes;
+        count += chunk.size();
+    }
+    offsets[m->nbucket] = count;
+    
+    // Offsets de 32 bits: con keys int el mapa nunca pasa de 2^32 entradas
+    if (ok && count > UINT32_MAX) {
+        fprintf(stderr, "snapshot_write: too many entries for 32-bit offsets\n");
+        ok = false;
+    }
+    if (ok) {
+        size_t bytes = offsets.size() * sizeof(uint32_t);
+        ok = pwrite(fd, offsets.data(), bytes, pos) == (ssize_t)bytes;
+    }
+    if (ok) {
+        memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+        hdr.nbucket = m->nbucket;
+        hdr.count = count;
+        hdr.offsets_pos = pos;
+        ok = pwrite(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr);
+    }
+    
+    if (!ok) {
+        perror("snapshot_write: pwrite");
+    }
+    close(fd);
+    return ok;
+}
+
+struct SnapshotJob {
+    MapRW* map;
+    const char* path;
+    bool ok;
+    double seconds;
+};
+
+// Punto de entrada para escribir el snapshot desde un thread de fondo
+void* snapshot_thread(void* p) {
+    SnapshotJob* job = static_cast<SnapshotJob*>(p);
+    double start = now_s();
+    job->ok = snapshot_write(job->map, job->path);
+    job->seconds = now_s() - start;
+    return nullptr;
+}
+
+// Vista de solo lectura sobre el archivo mapeado. Sirve lookups directamente
+// desde el mmap mientras el mapa real todavia se esta construyendo.
+struct SnapshotView {
+    void* base;
+    size_t size;
+    const SnapshotHeader* hdr;
+    const SnapEntry* entries;
+    const uint32_t* offsets;
+};
+
+// Todo lo que viene del archivo se valida contra el largo mapeado antes de
+// usarlo como indice: las entries deben caber entre el header y la tabla de
+// offsets, la tabla debe terminar justo al final del archivo y los offsets
+// deben ser crecientes y no pasar de count
+static bool snapshot_valid(const SnapshotHeader* hdr, uint64_t size) {
+    if (memcmp(hdr->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0 || hdr->nbucket == 0) {
+        return false;
+    }
+    uint64_t entries_end = sizeof(SnapshotHeader);
+    if (hdr->count > (size - entries_end) / sizeof(SnapEntry)) {
+        return false;
+    }
+    entries_end += hdr->count * sizeof(SnapEntry);
+    uint64_t table_bytes = ((uint64_t)hdr->nbucket + 1) * sizeof(uint32_t);
+    if (hdr->offsets_pos != entries_end || table_bytes > size - entries_end ||
+        entries_end + table_bytes != size) {
+        return false;
+    }
+    
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(
+        reinterpret_cast<const char*>(hdr) + hdr->offsets_pos);
+    if (offsets[0] != 0 || offsets[hdr->nbucket] != hdr->count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < hdr->nbucket; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool snapshot_open(const char* path, SnapshotView* view) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("snapshot_open: open");
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+        fprintf(stderr, "snapshot_open: %s is too small\n", path);
+        close(fd);
+        return false;
+    }
+    
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("snapshot_open: mmap");
+        return false;
+    }
+    
+    const SnapshotHeader* hdr = static_cast<const SnapshotHeader*>(base);
+    if (!snapshot_valid(hdr, st.st_size)) {
+        fprintf(stderr, "snapshot_open: %s is not a valid snapshot\n", path);
+        munmap(base, st.st_size);
+        return false;
+    }
+    
+    view->base = base;
+    view->size = st.st_size;
+    view->hdr = hdr;
+    view->entries = reinterpret_cast<const SnapEntry*>(hdr + 1);
+    view->offsets = reinterpret_cast<const uint32_t*>(static_cast<const char*>(base) + hdr->offsets_pos);
+    return true;
+}
+
+void snapshot_close(SnapshotView* view) {
+    munmap(view->base, view->size);
+    view->base = nullptr;
+}
+
+int snapshot_view_get(const SnapshotView* view, int k) {
+    uint32_t bucket = ((unsigned int)k) % view->hdr->nbucket;
+    for (uint32_t i = view->offsets[bucket]; i < view->offsets[bucket + 1]; i++) {
+        if (view->entries[i].k == k) {
+            return view->entries[i].v;
+        }
+    }
+    return -1;
+}
+
+struct LoadArgs {
+    const SnapshotView* view;
+    MapRW* map;
+    int first_bucket;
+    int last_bucket;
+};
+
+void* load_worker(void* p) {
+    LoadArgs* args = static_cast<LoadArgs*>(p);
+    const SnapshotView* view = args->view;
+    
+    for (int i = args->first_bucket; i < args->last_bucket; i++) {
+        // Reconstruir la cadena en el mismo orden en que se guardo
+        Node** tail = &args->map->b[i];
+        for (uint32_t e = view->offsets[i]; e < view->offsets[i + 1]; e++) {
+            *tail = new Node(view->entries[e].k, view->entries[e].v);
+            tail = &(*tail)->next;
+        }
+    }
+    return nullptr;
+}
+
+// Construye los buckets de m en paralelo desde la vista. m debe estar vacio,
+// tener el mismo nbucket que el snapshot y no estar publicado todavia: cada
+// thread escribe un rango disjunto de buckets sin tomar el lock.
+bool snapshot_load(const SnapshotView* view, MapRW* m, int num_threads) {
+    if ((int)view->hdr->nbucket != m->nbucket) {
+        fprintf(stderr, "snapshot_load: bucket count mismatch (%u vs %d)\n",
+                view->hdr->nbucket, m->nbucket);
+        return false;
+    }
+    
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<LoadArgs> args(num_threads);
+    int per_thread = (m->nbucket + num_threads - 1) / num_threads;
+    
+    for (int i = 0; i < num_threads; i++) {
+        args[i].view = view;
+        args[i].map = m;
+        args[i].first_bucket = std::min(i * per_thread, m->nbucket);
+        args[i].last_bucket = std::min((i + 1) * per_thread, m->nbucket);
+        pthread_create(&threads[i], nullptr, load_worker, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Mapa generico: ConcurrentMap<K, V, Hash, Lock>
+// ---------------------------------------------------------------------------
+
+// String con small-string optimization: hasta SSO_INLINE bytes viven dentro
+// del nodo; solo keys mas largas hacen una segunda asignacion.
+class SsoString {
+public:
+    static const uint32_t SSO_INLINE = 23;
+    
+    explicit SsoString(std::string_view s) : len_(s.size()) {
+        if (len_ <= SSO_INLINE) {
+            memcpy(buf_, s.data(), len_);
+        } else {
+            ptr_ = new char[len_];
+            memcpy(ptr_, s.data(), len_);
+        }
+    }
+    
+    ~SsoString() {
+        if (len_ > SSO_INLINE) {
+            delete[] ptr_;
+        }
+    }
+    
+    SsoString(const SsoString&) = delete;
+    SsoString& operator=(const SsoString&) = delete;
+    
+    std::string_view view() const {
+        return std::string_view(len_ <= SSO_INLINE ? buf_ : ptr_, len_);
+    }
+    
+private:
+    uint32_t len_;
+    union {
+        char buf_[SSO_INLINE];
+        char* ptr_;
+    };
+};
+
+// Como se guarda y como se busca cada tipo de key. Para std::string la
+// busqueda recibe un string_view, asi que consultar no construye strings.
+template <typename K>
+struct KeyTraits {
+    typedef K stored_type;
+    typedef K lookup_type;
+    static bool equal(const K& stored, const K& k) { return stored == k; }
+};
+
+template <>
+struct KeyTraits<std::string> {
+    typedef SsoString stored_type;
+    typedef std::string_view lookup_type;
+    static bool equal(const SsoString& stored, std::string_view k) { return stored.view() == k; }
+};
+
+// Hash de enteros igual al de MapRW (modulo del numero de buckets)
+struct IntHash {
+    uint32_t operator()(int k) const { return (uint32_t)k; }
+};
+
+// FNV-1a sobre string_view: sirve igual para std::string y para literales
+struct StringHash {
+    uint32_t operator()(std::string_view s) const {
+        uint32_t h = 2166136261u;
+        for (unsigned char c : s) {
+            h = (h ^ c) * 16777619u;
+        }
+        return h;
+    }
+};
+
+// Politicas de lock: misma interfaz sobre rwlock, mutex y brlock
+struct RwLockPolicy {
+    pthread_rwlock_t rw;
+    explicit RwLockPolicy(RwPref pref = RW_PREF_DEFAULT) { rwlock_init_pref(&rw, pref); }
+    ~RwLockPolicy() { pthread_rwlock_destroy(&rw); }
+    void read_lock() { pthread_rwlock_rdlock(&rw); }
+    void read_unlock() { pthread_rwlock_unlock(&rw); }
+    void write_lock() { pthread_rwlock_wrlock(&rw); }
+    void write_unlock() { pthread_rwlock_unlock(&rw); }
+    static const char* name() { return "RWLOCK"; }
+};
+
+struct MutexPolicy {
+    pthread_mutex_t m;
+    MutexPolicy() { pthread_mutex_init(&m, nullptr); }
+    ~MutexPolicy() { pthread_mutex_destroy(&m); }
+    void read_lock() { pthread_mutex_lock(&m); }
+    void read_unlock() { pthread_mutex_unlock(&m); }
+    void write_lock() { pthread_mutex_lock(&m); }
+    void write_unlock() { pthread_mutex_unlock(&m); }
+    static const char* name() { return "MUTEX"; }
+};
+
+struct BrLockPolicy {
+    BrLock br;
+    void read_lock() { br_read_lock(&br); }
+    void read_unlock() { br_read_unlock(&br); }
+    void write_lock() { br_write_lock(&br); }
+    void write_unlock() { br_write_unlock(&br); }
+    static const char* name() { return "BRLOCK"; }
+};
+
+template <typename K, typename V, typename Hash, typename Lock>
+class ConcurrentMap {
+public:
+    typedef typename KeyTraits<K>::stored_type stored_key;
+    typedef typename KeyTraits<K>::lookup_type lookup_key;
+    
+    ConcurrentMap() {
+        for (int i = 0; i < NBUCKET; i++) {
+            b_[i] = nullptr;
+        }
+    }
+    
+    ~ConcurrentMap() {
+        for (int i = 0; i < NBUCKET; i++) {
+            GNode* curr = b_[i];
+            while (curr) {
+                GNode* next = curr->next;
+                delete curr;
+                curr = next;
+            }
+        }
+    }
+    
+    ConcurrentMap(const ConcurrentMap&) = delete;
+    ConcurrentMap& operator=(const ConcurrentMap&) = delete;
+    
+    static const char* lock_name() { return Lock::name(); }
+    
+    // Copia el valor en *out; devuelve false si la key no existe
+    bool get(lookup_key k, V* out) {
+        uint32_t h = hasher_(k);
+        lock_.read_lock();
+        GNode* n = find(b_[h % NBUCKET], h, k);
+        if (n) {
+            *out = n->v;
+        }
+        lock_.read_unlock();
+        return n != nullptr;
+    }
+    
+    void put(lookup_key k, const V& v) {
+        uint32_t h = hasher_(k);
+        lock_.write_lock();
+        GNode*& head = b_[h % NBUCKET];
+        GNode* n = find(head, h, k);
+        if (n) {
+            n->v = v;
+        } else {
+            n = new GNode(k, h, v);
+            n->next = head;
+            head = n;
+        }
+        lock_.write_unlock();
+    }
+    
+private:
+    // El hash completo se guarda en el nodo para descartar sin comparar keys
+    struct GNode {
+        GNode* next;
+        uint32_t hash;
+        stored_key k;
+        V v;
+        GNode(lookup_key key, uint32_t h, const V& val) : next(nullptr), hash(h), k(key), v(val) {}
+    };
+    
+    static GNode* find(GNode* curr, uint32_t h, lookup_key k) {
+        while (curr) {
+            if (curr->hash == h && KeyTraits<K>::equal(curr->k, k)) {
+                return curr;
+            }
+            curr = curr->next;
+        }
+        return nullptr;
+    }
+    
+    GNode* b_[NBUCKET];
+    Lock lock_;
+    Hash hasher_;
+};
+
+// Valor de ejemplo tipo registro para los benchmarks con keys string
+struct Record {
+    long id;
+    double score;
+    int hits;
+};
+
+template <typename Map>
+struct GenericArgs {
+    Map* map;
+    const std::vector<typename Map::lookup_key>* keys;
+    int operations;
+    int read_percentage;
+    int thread_id;
+    long checksum;
+};
+
+template <typename Map>
+void* worker_generic(void* p) {
+    GenericArgs<Map>* args = static_cast<GenericArgs<Map>*>(p);
+    std::mt19937 gen(args->thread_id);
+    std::uniform_int_distribution<> dis(0, 99);
+    std::uniform_int_distribution<> key_dis(0, args->keys->size() - 1);
+    long checksum = 0;
+    Record r;
+    
+    for (int i = 0; i < args->operations; i++) {
+        int idx = key_dis(gen);
+        
+        if (dis(gen) < args->read_percentage) {
+            if (args->map->get((*args->keys)[idx], &r)) {
+                checksum += r.hits;
+            }
+        } else {
+            args->map->put((*args->keys)[idx], Record{idx, idx * 0.5, idx});
+        }
+    }
+    
+    args->checksum = checksum;
+    return nullptr;
+}
+
+template <typename Map>
+void run_generic(const char* workload, const std::vector<typename Map::lookup_key>& keys,
+                 int num_threads, int ops_per_thread, int read_percentage) {
+    Map map;
+    for (size_t i = 0; i < keys.size(); i++) {
+        map.put(keys[i], Record{(long)i, i * 0.5, (int)i});
+    }
+    
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<GenericArgs<Map>> args(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        args[i] = {&map, &keys, ops_per_thread, read_percentage, i, 0};
+    }
+    
+    double start = now_s();
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], nullptr, worker_generic<Map>, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    double end = now_s();
+    
+    double total_ops = (double)num_threads * ops_per_thread;
+    printf("%-9s %-7s %.3fs, %.0f ops/sec, %.1f ns/op\n", workload, Map::lock_name(),
+           end - start, total_ops / (end - start), (end - start) * 1e9 / total_ops);
+}
+
+template <typename Lock>
+void run_key_workloads(const std::vector<int>& int_keys,
+                       const std::vector<std::string_view>& short_keys,
+                       const std::vector<std::string_view>& long_keys,
+                       int num_threads, int ops_per_thread, int read_percentage) {
+    run_generic<ConcurrentMap<int, Record, IntHash, Lock>>(
+        "int", int_keys, num_threads, ops_per_thread, read_percentage);
+    run_generic<ConcurrentMap<std::string, Record, StringHash, Lock>>(
+        "str-short", short_keys, num_threads, ops_per_thread, read_percentage);
+    run_generic<ConcurrentMap<std::string, Record, StringHash, Lock>>(
+        "str-long", long_keys, num_threads, ops_per_thread, read_percentage);
+}
+
+// Keys int vs strings cortas (inline en el nodo) vs strings largas (heap),
+// con cada politica de lock, para separar costo de hash/comparacion del lock
+void test_string_keys(int num_threads, int ops_per_thread) {
+    const int NKEYS = 10000;
+    const int read_percentage = 90;
+    printf("\n=== Key Types (Threads: %d, Ops: %d, Reads: %d%%, Keys: %d) ===\n",
+           num_threads, ops_per_thread, read_percentage, NKEYS);
+    
+    // Las strings viven aqui; los workers solo ven string_views
+    std::vector<std::string> short_storage, long_storage;
+    std::vector<int> int_keys;
+    char buf[64];
+    for (int i = 0; i < NKEYS; i++) {
+        snprintf(buf, sizeof(buf), "user:%06d", i);
+        short_storage.push_back(buf);
+        snprintf(buf, sizeof(buf), "tenant/eu-west/session/%010d", i);
+        long_storage.push_back(buf);
+        int_keys.push_back(i);
+    }
+    std::vector<std::string_view> short_keys(short_storage.begin(), short_storage.end());
+    std::vector<std::string_view> long_keys(long_storage.begin(), long_storage.end());
+    
+    run_key_workloads<RwLockPolicy>(int_keys, short_keys, long_keys,
+                                    num_threads, ops_per_thread, read_percentage);
+    run_key_workloads<MutexPolicy>(int_keys, short_keys, long_keys,
+                                   num_threads, ops_per_thread, read_percentage);
+    run_key_workloads<BrLockPolicy>(int_keys, short_keys, long_keys,
+                                    num_threads, ops_per_thread, read_percentage);
+}
+
+struct BatchArgs {
+    MapRW* map;
+    const int* keys;
+    int nkeys;
+    int batch;  // 0 = usar la API de una sola key
+    bool write;
+    long checksum;  // Consumir resultados para que el compilador no elimine los gets
+};
+
+void* worker_batch(void* p) {
+    BatchArgs* args = static_cast<BatchArgs*>(p);
+    std::vector<int> out(std::max(args->batch, 1));
+    long checksum = 0;
+    
+    if (args->batch == 0) {
+        for (int i = 0; i < args->nkeys; i++) {
+            int k = args->keys[i];
+            if (args->write) {
+                map_put_rw(args->map, k, k * 2);
+            } else {
+                checksum += map_get_rw(args->map, k);
+            }
+        }
+        args->checksum = checksum;
+        return nullptr;
+    }
+    
+    std::vector<int> vals(args->batch);
+    for (int i = 0; i < args->nkeys; i += args->batch) {
+        int n = std::min(args->batch, args->nkeys - i);
+        const int* keys = args->keys + i;
+        if (args->write) {
+            for (int j = 0; j < n; j++) {
+                vals[j] = keys[j] * 2;
+            }
+            map_put_many(args->map, keys, vals.data(), n);
+        } else {
+            map_get_many(args->map, keys, out.data(), n);
+            for (int j = 0; j < n; j++) {
+                checksum += out[j];
+            }
+        }
+    }
+    args->checksum = checksum;
+    return nullptr;
+}
+
+// Corre un lote de threads sobre el mismo mapa y devuelve el tiempo total
+static double run_batch_threads(MapRW* map, const std::vector<std::vector<int>>& keys,
+                                int batch, bool write) {
+    int num_threads = keys.size();
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<BatchArgs> args(num_threads);
+    
+    for (int i = 0; i < num_threads; i++) {
+        args[i] = {map, keys[i].data(), (int)keys[i].size(), batch, write, 0};
+    }
+    
+    double start = now_s();
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], nullptr, worker_batch, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    return now_s() - start;
+}
+
+// Barrido de tamaño de lote: costo por key de map_get_many/map_put_many
+// frente a llamar map_get_rw/map_put_rw una key a la vez
+void test_batch_sweep(int num_threads, int ops_per_thread) {
+    printf("\n=== Batch Sweep (Threads: %d, Keys/thread: %d) ===\n",
+           num_threads, ops_per_thread);
+    
+    MapRW map;
+    for (int k = 0; k < 10000; k++) {
+        map_put_rw(&map, k, k * 2);
+    }
+    
+    // Generar las keys antes de medir para no contar el costo del RNG
+    std::vector<std::vector<int>> keys(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        std::mt19937 gen(i);
+        std::uniform_int_distribution<> key_dis(0, 9999);
+        keys[i].resize(ops_per_thread);
+        for (int& k : keys[i]) {
+            k = key_dis(gen);
+        }
+    }
+    
+    const int batches[] = {1, 4, 16, 64, 256};
+    double total_keys = (double)num_threads * ops_per_thread;
+    
+    for (int write = 0; write <= 1; write++) {
+        const char* op = write ? "put" : "get";
+        double single = run_batch_threads(&map, keys, 0, write);
+        double single_ns = single * 1e9 / total_keys;
+        printf("%s single-key: %7.1f ns/key\n", op, single_ns);
+        
+        for (int batch : batches) {
+            double t = run_batch_threads(&map, keys, batch, write);
+            double ns = t * 1e9 / total_keys;
+            printf("%s_many batch=%-4d %7.1f ns/key (%.2fx vs single)\n",
+                   op, batch, ns, single_ns / ns);
+        }
+    }
+}
+
+struct SnapshotWriterArgs {
+    MapRW* map;
+    int nkeys;
+    const std::atomic<bool>* stop;
+    double max_wait;
+    long puts;
+};
+
+// Writer que sigue haciendo puts mientras corre el snapshot
+void* snapshot_writer(void* p) {
+    SnapshotWriterArgs* args = static_cast<SnapshotWriterArgs*>(p);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> key_dis(0, args->nkeys - 1);
+    
+    while (!args->stop->load(std::memory_order_acquire)) {
+        int k = key_dis(gen);
+        double t0 = now_s();
+        map_put_rw(args->map, k, k * 2);
+        args->max_wait = std::max(args->max_wait, now_s() - t0);
+        args->puts++;
+    }
+    return nullptr;
+}
+
+// Menor potencia de dos >= n, para mantener cadenas cortas en mapas grandes
+static int buckets_for(long n) {
+    int nb = NBUCKET;
+    while (nb < n && nb < (1 << 30)) {
+        nb <<= 1;
+    }
+    return nb;
+}
+
+// Reconstruir con map_put_rw vs snapshot en fondo + carga paralela con mmap
+void test_snapshot(int num_threads, long max_keys) {
+    const char* path = "p3_snapshot.bin";
+    const long sizes[] = {1000000, 10000000, 50000000};
+    
+    printf("\n=== Snapshot / Warm Start (Loader threads: %d, Max keys: %ld) ===\n",
+           num_threads, max_keys);
+    
+    for (long n : sizes) {
+        if (n > max_keys) {
+            // Con un limite menor al primer tamaño, correr solo el limite
+            if (n != sizes[0]) {
+                break;
+            }
+            n = max_keys;
+        }
+        int nbucket = buckets_for(n);
+        printf("\n-- %ld keys, %d buckets --\n", n, nbucket);
+        
+        // Línea base: reconstruir con un map_put_rw por key
+        double rebuild;
+        {
+            MapRW map(RW_PREF_DEFAULT, nbucket);
+            double start = now_s();
+            for (long k = 0; k < n; k++) {
+                map_put_rw(&map, k, k * 2);
+            }
+            int first = map_get_rw(&map, 0);
+            rebuild = now_s() - start;
+            printf("map_put_rw rebuild:     %.3fs (first lookup=%d)\n", rebuild, first);
+            
+            // Snapshot en un thread de fondo con un writer concurrente
+            std::atomic<bool> stop(false);
+            SnapshotWriterArgs wargs = {&map, (int)n, &stop, 0.0, 0};
+            SnapshotJob job = {&map, path, false, 0.0};
+            pthread_t writer, snapper;
+            pthread_create(&writer, nullptr, snapshot_writer, &wargs);
+            pthread_create(&snapper, nullptr, snapshot_thread, &job);
+            pthread_join(snapper, nullptr);
+            stop.store(true, std::memory_order_release);
+            pthread_join(writer, nullptr);
+            
+            if (!job.ok) {
+                printf("snapshot failed\n");
+                return;
+            }
+            printf("snapshot write:         %.3fs (%ld concurrent puts, max put wait %.1fus)\n",
+                   job.seconds, wargs.puts, wargs.max_wait * 1e6);
+        }
+        
+        // Warm start: primer lookup servido desde el mmap, luego carga paralela
+        double start = now_s();
+        SnapshotView view;
+        if (!snapshot_open(path, &view)) {
+            return;
+        }
+        int first = snapshot_view_get(&view, 0);
+        double first_lookup = now_s() - start;
+        
+        MapRW loaded(RW_PREF_DEFAULT, view.hdr->nbucket);
+        snapshot_load(&view, &loaded, num_threads);
+        double load = now_s() - start;
+        
+        // Verificar una muestra contra la vista
+        int mismatches = 0;
+        for (long k = 0; k < n; k += std::max(1L, n / 1000)) {
+            if (map_get_rw(&loaded, k) != snapshot_view_get(&view, k)) {
+                mismatches++;
+            }
+        }
+        printf("snapshot size:          %.1f MB\n", view.size / 1048576.0);
+        printf("time to first lookup:   %.6fs via mmap (value=%d)\n", first_lookup, first);
+        printf("parallel load:          %.3fs (%.2fx vs rebuild, %d mismatches)\n",
+               load, rebuild / load, mismatches);
+        
+        snapshot_close(&view);
+        unlink(path);
+    }
+}
+
+// Bytes en uso segun el allocator (heap + bloques servidos con mmap)
+static size_t heap_bytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+struct LookupArgs {
+    void* map;
+    long nkeys;
+    int operations;
+    int thread_id;
+    long checksum;
+};
+
+template <typename Map>
+void* worker_lookup(void* p) {
+    LookupArgs* args = static_cast<LookupArgs*>(p);
+    Map* map = static_cast<Map*>(args->map);
+    std::mt19937 gen(args->thread_id);
+    std::uniform_int_distribution<long> key_dis(0, args->nkeys - 1);
+    long checksum = 0;
+    
+    for (int i = 0; i < args->operations; i++) {
+        checksum += map_get(map, key_dis(gen));
+    }
+    args->checksum = checksum;
+    return nullptr;
+}
+
+template <typename Map>
+double run_lookups(Map* map, long nkeys, int num_threads, int ops_per_thread) {
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<LookupArgs> args(num_threads);
+    
+    double start = now_s();
+    for (int i = 0; i < num_threads; i++) {
+        args[i] = {map, nkeys, ops_per_thread, i, 0};
+        pthread_create(&threads[i], nullptr, worker_lookup<Map>, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    return (double)num_threads * ops_per_thread / (now_s() - start);
+}
+
+// Bytes por key y throughput de lookups: MapRW (un malloc por nodo) vs
+// CompactMap (pool de 12 bytes por entrada + entrada inline por bucket)
+void test_compact(int num_threads, long max_keys) {
+    const long sizes[] = {1000000, 50000000};
+    const int lookups_per_thread = 1000000;
+    
+    printf("\n=== Compact Layout (Threads: %d, Max keys: %ld) ===\n", num_threads, max_keys);
+    printf("sizeof(Node)=%zu, sizeof(CompactEntry)=%zu\n", sizeof(Node), sizeof(CompactEntry));
+    
+    for (long n : sizes) {
+        if (n > max_keys) {
+            if (n != sizes[0]) {
+                break;
+            }
+            n = max_keys;
+        }
+        printf("\n-- %ld keys --\n", n);
+        
+        {
+            size_t before = heap_bytes();
+            MapRW map(RW_PREF_DEFAULT, buckets_for(n));
+            for (long k = 0; k < n; k++) {
+                map_put_rw(&map, k, k * 2);
+            }
+            // Los buckets salen de huge_alloc (mmap), fuera de lo que ve malloc
+            size_t bytes = heap_bytes() - before + (size_t)map.nbucket * sizeof(Node*);
+            double ops = run_lookups(&map, n, num_threads, lookups_per_thread);
+            printf("MapRW:      %6.1f bytes/key, %.0f lookups/sec\n", (double)bytes / n, ops);
+        }
+        
+        {
+            // Factor de carga 2: la mayoria de buckets tiene su entrada inline
+            CompactMap map(buckets_for(n / 2));
+            for (long k = 0; k < n; k++) {
+                compact_put(&map, k, k * 2);
+            }
+            double ops = run_lookups(&map, n, num_threads, lookups_per_thread);
+            printf("CompactMap: %6.1f bytes/key, %.0f lookups/sec (pool entries: %u)\n",
+                   (double)map.bytes_used() / n, ops, map.pool_next.load() - 1);
+        }
+    }
+}
+
+// Contador de perf o "n/a" si el kernel no lo permite
+static std::string format_count(long value) {
+    return value < 0 ? std::string("n/a") : std::to_string(value);
+}
+
+// Lookups aleatorios sobre mapas grandes con y sin paginas de 2 MiB. Solo
+// las regiones grandes (buckets y pool) cambian de respaldo; los nodos de
+// MapRW siguen saliendo de malloc.
+void test_hugepages(int num_threads, long nkeys) {
+    const int lookups_per_thread = 2000000;
+    bool requested = hugepages_enabled();
+    
+    printf("\n=== Huge Pages (Threads: %d, Keys: %ld) ===\n", num_threads, nkeys);
+    
+    for (int on = 0; on <= 1; on++) {
+        hugepages_enabled() = on;
+        huge_stats() = HugeStats{0, 0, 0};
+        
+        {
+            MapRW map(RW_PREF_DEFAULT, buckets_for(nkeys));
+            for (long k = 0; k < nkeys; k++) {
+                map_put_rw(&map, k, k * 2);
+            }
+            DtlbCounter dtlb;
+            dtlb.start();
+            double ops = run_lookups(&map, nkeys, num_threads, lookups_per_thread);
+            long misses = dtlb.stop();
+            printf("%-4s MapRW:      %.0f lookups/sec, dTLB misses %s\n", on ? "2M" : "4K",
+                   ops, format_count(misses).c_str());
+        }
+        
+        {
+            CompactMap map(buckets_for(nkeys / 2));
+            for (long k = 0; k < nkeys; k++) {
+                compact_put(&map, k, k * 2);
+            }
+            DtlbCounter dtlb;
+            dtlb.start();
+            double ops = run_lookups(&map, nkeys, num_threads, lookups_per_thread);
+            long misses = dtlb.stop();
+            printf("%-4s CompactMap: %.0f lookups/sec, dTLB misses %s\n", on ? "2M" : "4K",
+                   ops, format_count(misses).c_str());
+        }
+        print_huge_stats();
+    }
+    
+    hugepages_enabled() = requested;
+}
+
+int main(int argc, char** argv) {
+    argc = parse_hugepages_flag(argc, argv);
+    int num_threads = (argc > 1) ? std::atoi(argv[1]) : 4;
+    int ops_per_thread = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    const char* mode = (argc > 3) ? argv[3] : "scenarios";
+    
+    printf("Readers/Writers Performance Comparison\n");
+    
+    if (strcmp(mode, "scenarios") == 0) {
+        test_scenario("99/1 Read/Write", num_threads, ops_per_thread, 99);
+        test_scenario("90/10 Read/Write", num_threads, ops_per_thread, 90);
+        test_scenario("70/30 Read/Write", num_threads, ops_per_thread, 70);
+        test_scenario("50/50 Read/Write", num_threads, ops_per_thread, 50);
+        test_scan_scenario("80/10/10 Read/Scan/Write", num_threads, ops_per_thread, 80, 10);
+    } else if (strcmp(mode, "batch") == 0) {
+        test_batch_sweep(num_threads, ops_per_thread);
+    } else if (strcmp(mode, "strings") == 0) {
+        test_string_keys(num_threads, ops_per_thread);
+    } else if (strcmp(mode, "snapshot") == 0) {
+        // En este modo el segundo argumento es el maximo de keys (1M-50M)
+        long max_keys = (argc > 2) ? std::atol(argv[2]) : 1000000;
+        test_snapshot(num_threads, max_keys);
+    } else if (strcmp(mode, "compact") == 0) {
+        // Igual que snapshot: el segundo argumento es el maximo de keys
+        long max_keys = (argc > 2) ? std::atol(argv[2]) : 1000000;
+        test_compact(num_threads, max_keys);
+    } else if (strcmp(mode, "hugepages") == 0) {
+        long nkeys = (argc > 2) ? std::atol(argv[2]) : 4000000;
+        test_hugepages(num_threads, nkeys);
+    } else {
+        printf("Usage: %s [threads] [ops_per_thread] [mode] [--hugepages]\n", argv[0]);
+        printf("  scenarios: rwlock/mutex/brlock/skiplist con distintas mezclas (default)\n");
+        printf("  batch:     map_get_many/map_put_many vs API de una key\n");
+        printf("  strings:   ConcurrentMap con keys int/string por politica de lock\n");
+        printf("  snapshot:  snapshot en disco + carga mmap (2do argumento = max keys)\n");
+        printf("  compact:   bytes/key y lookups de CompactMap vs MapRW (2do argumento = max keys)\n");
+        printf("  hugepages: lookups y misses de dTLB con paginas de 4K vs 2M (2do argumento = keys)\n");
+        printf("  --hugepages respalda buckets y pools con paginas de 2 MiB en cualquier modo\n");
+        return 1;
+    }
     
     return 0;
 }
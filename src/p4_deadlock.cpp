@@ -11,6 +11,16 @@
 #include <errno.h>
 #include <cstdlib>
 #include <signal.h>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <sched.h>
+#include "flat_combining.hpp"
+#include "async_log.hpp"
+#include <cstdint>
 
 inline double now_s() {
     struct timespec ts;
@@ -20,8 +30,164 @@ inline double now_s() {
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-pthread_mutex_t A = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t B = PTHREAD_MUTEX_INITIALIZER;
+// ---------------------------------------------------------------------------
+// Validador de orden de locks (estilo lockdep)
+// ---------------------------------------------------------------------------
+//
+// Cada lock pertenece a una clase. Al adquirir la clase C con las clases H
+// ya tomadas por el thread, se registra la arista H -> C en un grafo global de
+// bitsets. Si la arista es nueva y C ya alcanzaba a H, existe un orden
+// invertido (ABBA) y se reporta una vez por par, aunque en esta corrida los
+// threads nunca se hayan bloqueado. El camino rapido (arista ya conocida) es
+// un load relajado por cada lock tomado, asi que se puede dejar encendido.
+//
+// Los locks de una misma clase (las cuentas) llevan una llave por instancia:
+// la regla es tomarlos en orden creciente de llave, y anidar uno con llave
+// menor o igual a otro ya tomado se reporta en el momento.
+
+const int LOCKDEP_MAX_CLASSES = 64;
+const int LOCKDEP_MAX_HELD = 16;
+const long LOCKDEP_NO_KEY = -1;    // Clase sin orden entre instancias
+
+struct LockdepHeld {
+    int cls;
+    long key;
+};
+
+static std::atomic<uint64_t> lockdep_after[LOCKDEP_MAX_CLASSES];     // Fila i: clases tomadas con i tomada
+static std::atomic<uint64_t> lockdep_reported[LOCKDEP_MAX_CLASSES];
+static std::atomic<int> lockdep_nclasses(0);
+static std::atomic<long> lockdep_reports(0);
+static const char* lockdep_names[LOCKDEP_MAX_CLASSES];
+
+static thread_local LockdepHeld lockdep_held[LOCKDEP_MAX_HELD];
+static thread_local int lockdep_nheld = 0;
+
+int lockdep_register(const char* name) {
+    int id = lockdep_nclasses.fetch_add(1);
+    if (id >= LOCKDEP_MAX_CLASSES) {
+        fprintf(stderr, "lockdep: too many lock classes\n");
+        exit(1);
+    }
+    lockdep_names[id] = name;
+    return id;
+}
+
+// Serializa la insercion de aristas nuevas (el camino lento)
+static pthread_mutex_t lockdep_graph_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Todas las clases alcanzables desde from siguiendo aristas conocidas
+static uint64_t lockdep_reachable(int from) {
+    uint64_t seen = 0;
+    uint64_t frontier = lockdep_after[from].load(std::memory_order_acquire);
+    while (frontier & ~seen) {
+        uint64_t fresh = frontier & ~seen;
+        seen |= fresh;
+        while (fresh) {
+            int c = __builtin_ctzll(fresh);
+            fresh &= fresh - 1;
+            frontier |= lockdep_after[c].load(std::memory_order_acquire);
+        }
+    }
+    return seen;
+}
+
+static void lockdep_report(int held, int cls) {
+    uint64_t bit = 1ull << cls;
+    if (lockdep_reported[held].fetch_or(bit) & bit) {
+        return;
+    }
+    lockdep_reports.fetch_add(1);
+    fprintf(stderr, "lockdep: possible ABBA deadlock: acquiring %s/%d while holding %s/%d, "
+            "but %s/%d is already known to be taken before %s/%d\n",
+            lockdep_names[cls], cls, lockdep_names[held], held,
+            lockdep_names[cls], cls, lockdep_names[held], held);
+}
+
+// Dos instancias de la misma clase tomadas fuera de orden; una vez por clase
+static void lockdep_report_order(int cls, long held_key, long key) {
+    uint64_t bit = 1ull << cls;
+    if (lockdep_reported[cls].fetch_or(bit) & bit) {
+        return;
+    }
+    lockdep_reports.fetch_add(1);
+    fprintf(stderr, "lockdep: out-of-order acquisition: acquiring %s #%ld while holding %s #%ld, "
+            "but %s locks must be taken in increasing order\n",
+            lockdep_names[cls], key, lockdep_names[cls], held_key, lockdep_names[cls]);
+}
+
+// Llamar antes de bloquear: asi el reporte sale aunque el lock nunca llegue
+void lockdep_acquire(int cls, long key = LOCKDEP_NO_KEY) {
+    for (int i = 0; i < lockdep_nheld; i++) {
+        int h = lockdep_held[i].cls;
+        if (h == cls && key != LOCKDEP_NO_KEY) {
+            // Misma clase con llaves: vale solo en orden creciente
+            if (key <= lockdep_held[i].key) {
+                lockdep_report_order(cls, lockdep_held[i].key, key);
+            }
+            continue;
+        }
+        uint64_t bit = 1ull << cls;
+        if (lockdep_after[h].load(std::memory_order_acquire) & bit) {
+            continue;  // Camino rapido: orden ya visto
+        }
+        // Arista nueva: revisar e insertar bajo un mismo lock, si no dos
+        // threads con A->B y B->A a la vez pasan ambos el chequeo
+        pthread_mutex_lock(&lockdep_graph_mutex);
+        if (!(lockdep_after[h].load(std::memory_order_relaxed) & bit)) {
+            if (h == cls || (lockdep_reachable(cls) & (1ull << h))) {
+                lockdep_report(h, cls);
+            }
+            lockdep_after[h].fetch_or(bit, std::memory_order_acq_rel);
+        }
+        pthread_mutex_unlock(&lockdep_graph_mutex);
+    }
+    if (lockdep_nheld < LOCKDEP_MAX_HELD) {
+        lockdep_held[lockdep_nheld++] = {cls, key};
+    }
+}
+
+void lockdep_release(int cls, long key = LOCKDEP_NO_KEY) {
+    // Los locks no siempre se liberan en orden LIFO
+    for (int i = lockdep_nheld - 1; i >= 0; i--) {
+        if (lockdep_held[i].cls == cls && lockdep_held[i].key == key) {
+            lockdep_held[i] = lockdep_held[--lockdep_nheld];
+            return;
+        }
+    }
+}
+
+// Mutex instrumentado; key ordena las instancias de una misma clase
+struct DepMutex {
+    pthread_mutex_t m;
+    int cls;
+    long key;
+    
+    void init(int lock_class, long instance_key = LOCKDEP_NO_KEY) {
+        cls = lock_class;
+        key = instance_key;
+        pthread_mutex_init(&m, nullptr);
+    }
+    
+    void destroy() {
+        pthread_mutex_destroy(&m);
+    }
+};
+
+void dep_lock(DepMutex* d) {
+    lockdep_acquire(d->cls, d->key);
+    pthread_mutex_lock(&d->m);
+}
+
+void dep_unlock(DepMutex* d) {
+    pthread_mutex_unlock(&d->m);
+    lockdep_release(d->cls, d->key);
+}
+
+// A siempre antes que B; pasan por lockdep para que una inversion se reporte
+// aunque no llegue a bloquear
+DepMutex A = {PTHREAD_MUTEX_INITIALIZER, lockdep_register("A"), LOCKDEP_NO_KEY};
+DepMutex B = {PTHREAD_MUTEX_INITIALIZER, lockdep_register("B"), LOCKDEP_NO_KEY};
 
 // Variables para controlar timeout en macOS
 volatile bool test_finished = false;
@@ -30,16 +196,16 @@ pthread_t timeout_thread;
 // Versión deadlock - threads adquieren locks en orden diferente
 void* t1_deadlock(void*) {
     printf("T1: Acquiring A...\n");
-    pthread_mutex_lock(&A);
+    dep_lock(&A);
     printf("T1: Got A, sleeping...\n");
     usleep(1000); // Dar oportunidad al otro thread de adquirir B
     
     printf("T1: Acquiring B...\n");
-    pthread_mutex_lock(&B);
+    dep_lock(&B);
     printf("T1: Got both locks!\n");
     
-    pthread_mutex_unlock(&B);
-    pthread_mutex_unlock(&A);
+    dep_unlock(&B);
+    dep_unlock(&A);
     printf("T1: Released both locks\n");
     test_finished = true;
     return nullptr;
@@ -47,16 +213,16 @@ void* t1_deadlock(void*) {
 
 void* t2_deadlock(void*) {
     printf("T2: Acquiring B...\n");
-    pthread_mutex_lock(&B);
+    dep_lock(&B);
     printf("T2: Got B, sleeping...\n");
     usleep(1000); // Dar oportunidad al otro thread de adquirir A
     
     printf("T2: Acquiring A...\n");
-    pthread_mutex_lock(&A);
+    dep_lock(&A);
     printf("T2: Got both locks!\n");
     
-    pthread_mutex_unlock(&A);
-    pthread_mutex_unlock(&B);
+    dep_unlock(&A);
+    dep_unlock(&B);
     printf("T2: Released both locks\n");
     test_finished = true;
     return nullptr;
@@ -65,80 +231,176 @@ void* t2_deadlock(void*) {
 // Versión corregida 1 - Ordenar locks consistentemente (A antes de B)
 void* t1_ordered(void*) {
     printf("T1: Acquiring A (ordered)...\n");
-    pthread_mutex_lock(&A);
+    dep_lock(&A);
     printf("T1: Got A, sleeping...\n");
     usleep(1000);
     
     printf("T1: Acquiring B (ordered)...\n");
-    pthread_mutex_lock(&B);
+    dep_lock(&B);
     printf("T1: Got both locks!\n");
     
-    pthread_mutex_unlock(&B);
-    pthread_mutex_unlock(&A);
+    dep_unlock(&B);
+    dep_unlock(&A);
     printf("T1: Released both locks\n");
     return nullptr;
 }
 
 void* t2_ordered(void*) {
     printf("T2: Acquiring A (ordered)...\n");
-    pthread_mutex_lock(&A);
+    dep_lock(&A);
     printf("T2: Got A, sleeping...\n");
     usleep(1000);
     
     printf("T2: Acquiring B (ordered)...\n");
-    pthread_mutex_lock(&B);
+    dep_lock(&B);
     printf("T2: Got both locks!\n");
     
-    pthread_mutex_unlock(&B);
-    pthread_mutex_unlock(&A);
+    dep_unlock(&B);
+    dep_unlock(&A);
     printf("T2: Released both locks\n");
     return nullptr;
 }
 
-// Versión corregida 2 - trylock con backoff
+// Politicas de backoff para reintentos con trylock
+enum BackoffKind {
+    BACKOFF_FIXED,          // Siempre base_us
+    BACKOFF_EXPONENTIAL,    // base * 2^intento, truncado en cap
+    BACKOFF_FULL_JITTER,    // Uniforme en [0, exponencial truncado]
+    BACKOFF_DECORRELATED,   // Uniforme en [base, 3 * espera anterior], truncado
+    BACKOFF_ADAPTIVE        // Crece con la tasa de fallos observada por el thread
+};
+
+const char* backoff_name(BackoffKind kind) {
+    switch (kind) {
+        case BACKOFF_FIXED: return "fixed";
+        case BACKOFF_EXPONENTIAL: return "exponential";
+        case BACKOFF_FULL_JITTER: return "full-jitter";
+        case BACKOFF_DECORRELATED: return "decorrelated";
+        case BACKOFF_ADAPTIVE: return "adaptive";
+    }
+    return "?";
+}
+
+struct Backoff {
+    BackoffKind kind;
+    int base_us;
+    int cap_us;
+    int attempt;        // Fallos consecutivos
+    int prev_us;        // Ultima espera (decorrelated)
+    double success;     // Media movil de exitos de trylock (adaptive)
+    unsigned rng;
+    
+    void init(BackoffKind k, int base, int cap, unsigned seed) {
+        kind = k;
+        base_us = base;
+        cap_us = cap;
+        attempt = 0;
+        prev_us = base;
+        success = 1.0;
+        rng = seed | 1;
+    }
+    
+    unsigned next_rand() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+    
+    void on_success() {
+        attempt = 0;
+        prev_us = base_us;
+        success = success * 0.9 + 0.1;
+    }
+    
+    // Registra un fallo y devuelve cuanto esperar antes de reintentar
+    int on_failure() {
+        success *= 0.9;
+        int exp_us = base_us << std::min(attempt, 20);
+        int capped = std::min(cap_us, exp_us);
+        int delay = base_us;
+        
+        switch (kind) {
+            case BACKOFF_FIXED:
+                delay = base_us;
+                break;
+            case BACKOFF_EXPONENTIAL:
+                delay = capped;
+                break;
+            case BACKOFF_FULL_JITTER:
+                delay = next_rand() % (capped + 1);
+                break;
+            case BACKOFF_DECORRELATED: {
+                int hi = std::max(base_us + 1, prev_us * 3);
+                delay = std::min(cap_us, base_us + (int)(next_rand() % (hi - base_us)));
+                break;
+            }
+            case BACKOFF_ADAPTIVE: {
+                // Con mucho exito casi no espera; con mucha contencion se acerca
+                // al exponencial. Jitter de +-50% para no sincronizar threads.
+                double contention = 1.0 - success;
+                double target = base_us * (1 + attempt) * (1 + 15 * contention);
+                int t = (int)target;
+                delay = std::min(cap_us, t / 2 + (int)(next_rand() % (t + 1)));
+                break;
+            }
+        }
+        
+        attempt++;
+        prev_us = std::max(delay, base_us);
+        return delay;
+    }
+};
+
+// Versión corregida 2 - trylock con backoff. Un trylock no puede quedar
+// bloqueado, asi que estas versiones toman los mutex sin pasar por lockdep
 void* t1_trylock(void*) {
+    Backoff backoff;
+    backoff.init(BACKOFF_EXPONENTIAL, 100, 10000, 1);
     for (int attempt = 0; attempt < 10; attempt++) {
-        printf("T1: Attempt %d - Acquiring A...\n", attempt + 1);
-        pthread_mutex_lock(&A);
-        printf("T1: Got A, trying B...\n");
+        log_printf(stdout, "T1: Attempt %d - Acquiring A...\n", attempt + 1);
+        pthread_mutex_lock(&A.m);
+        log_printf(stdout, "T1: Got A, trying B...\n");
         
-        if (pthread_mutex_trylock(&B) == 0) {
-            printf("T1: Got both locks!\n");
-            pthread_mutex_unlock(&B);
-            pthread_mutex_unlock(&A);
-            printf("T1: Released both locks\n");
+        if (pthread_mutex_trylock(&B.m) == 0) {
+            log_printf(stdout, "T1: Got both locks!\n");
+            pthread_mutex_unlock(&B.m);
+            pthread_mutex_unlock(&A.m);
+            log_printf(stdout, "T1: Released both locks\n");
             return nullptr;
         }
         
-        printf("T1: Couldn't get B, backing off...\n");
-        pthread_mutex_unlock(&A);
-        usleep(100 * (attempt + 1)); // Backoff exponencial
+        log_printf(stdout, "T1: Couldn't get B, backing off...\n");
+        pthread_mutex_unlock(&A.m);
+        usleep(backoff.on_failure()); // Backoff exponencial truncado
     }
     
-    printf("T1: Failed to acquire both locks after 10 attempts\n");
+    log_printf(stdout, "T1: Failed to acquire both locks after 10 attempts\n");
     return nullptr;
 }
 
 void* t2_trylock(void*) {
+    Backoff backoff;
+    backoff.init(BACKOFF_EXPONENTIAL, 100, 10000, 2);
     for (int attempt = 0; attempt < 10; attempt++) {
-        printf("T2: Attempt %d - Acquiring B...\n", attempt + 1);
-        pthread_mutex_lock(&B);
-        printf("T2: Got B, trying A...\n");
+        log_printf(stdout, "T2: Attempt %d - Acquiring B...\n", attempt + 1);
+        pthread_mutex_lock(&B.m);
+        log_printf(stdout, "T2: Got B, trying A...\n");
         
-        if (pthread_mutex_trylock(&A) == 0) {
-            printf("T2: Got both locks!\n");
-            pthread_mutex_unlock(&A);
-            pthread_mutex_unlock(&B);
-            printf("T2: Released both locks\n");
+        if (pthread_mutex_trylock(&A.m) == 0) {
+            log_printf(stdout, "T2: Got both locks!\n");
+            pthread_mutex_unlock(&A.m);
+            pthread_mutex_unlock(&B.m);
+            log_printf(stdout, "T2: Released both locks\n");
             return nullptr;
         }
         
-        printf("T2: Couldn't get A, backing off...\n");
-        pthread_mutex_unlock(&B);
-        usleep(100 * (attempt + 1)); // Backoff exponencial
+        log_printf(stdout, "T2: Couldn't get A, backing off...\n");
+        pthread_mutex_unlock(&B.m);
+        usleep(backoff.on_failure()); // Backoff exponencial truncado
     }
     
-    printf("T2: Failed to acquire both locks after 10 attempts\n");
+    log_printf(stdout, "T2: Failed to acquire both locks after 10 attempts\n");
     return nullptr;
 }
 
@@ -167,11 +429,14 @@ void test_deadlock_scenario(const char* name, void* (*f1)(void*), void* (*f2)(vo
         pthread_create(&timeout_thread, nullptr, timeout_monitor, &timeout);
     }
     
+    async_log_barrier();
     pthread_create(&x, nullptr, f1, nullptr);
     pthread_create(&y, nullptr, f2, nullptr);
     
     pthread_join(x, nullptr);
     pthread_join(y, nullptr);
+    double joined = now_s();
+    async_log_barrier();
     
     test_finished = true;
     
@@ -181,30 +446,36 @@ void test_deadlock_scenario(const char* name, void* (*f1)(void*), void* (*f2)(vo
         pthread_join(timeout_thread, nullptr);
     }
     
-    double end = now_s();
-    printf("Both threads completed successfully in %.3fs\n", end - start);
+    printf("Both threads completed successfully in %.3fs\n", joined - start);
     
     // Resetear estado de mutex
-    pthread_mutex_destroy(&A);
-    pthread_mutex_destroy(&B);
-    pthread_mutex_init(&A, nullptr);
-    pthread_mutex_init(&B, nullptr);
+    A.destroy();
+    B.destroy();
+    A.init(A.cls);
+    B.init(B.cls);
 }
 
 // Simular escenario más complejo de deadlock
-struct Resource {
+// Clase lockdep de las cuentas: la llave es el id, asi lockdep valida la regla
+// de tomar primero la cuenta de id menor
+static int account_lock_class = lockdep_register("account");
+
+// Alineado a linea de cache para que cuentas vecinas no compartan linea
+struct alignas(64) Resource {
     int id;
-    pthread_mutex_t mutex;
+    DepMutex mutex;
     int value;
+    std::atomic<uint64_t> vlock;   // Modo optimista: (version << 1) | bit de lock
     
     void init(int _id) {
         id = _id;
         value = 0;
-        pthread_mutex_init(&mutex, nullptr);
+        vlock.store(0, std::memory_order_relaxed);
+        mutex.init(account_lock_class, _id);
     }
     
     void destroy() {
-        pthread_mutex_destroy(&mutex);
+        mutex.destroy();
     }
 };
 
@@ -214,6 +485,7 @@ struct TransferArgs {
     int amount;
     int iterations;
     const char* thread_name;
+    bool unordered;    // Solo test 6: simula una regresion que toma from antes que to
 };
 
 void* transfer_worker(void* p) {
@@ -221,27 +493,28 @@ void* transfer_worker(void* p) {
     
     for (int i = 0; i < args->iterations; i++) {
         // Adquirir locks en orden consistente (ID menor primero) para prevenir deadlock
-        Resource* first = (args->from->id < args->to->id) ? args->from : args->to;
-        Resource* second = (args->from->id < args->to->id) ? args->to : args->from;
+        bool from_first = args->unordered || args->from->id < args->to->id;
+        Resource* first = from_first ? args->from : args->to;
+        Resource* second = from_first ? args->to : args->from;
         
-        pthread_mutex_lock(&first->mutex);
-        printf("%s: Acquired lock on resource %d\n", args->thread_name, first->id);
+        dep_lock(&first->mutex);
+        log_printf(stdout, "%s: Acquired lock on resource %d\n", args->thread_name, first->id);
         
         usleep(100); // Simular trabajo
         
-        pthread_mutex_lock(&second->mutex);
-        printf("%s: Acquired lock on resource %d\n", args->thread_name, second->id);
+        dep_lock(&second->mutex);
+        log_printf(stdout, "%s: Acquired lock on resource %d\n", args->thread_name, second->id);
         
         // Realizar transferencia
         if (args->from->value >= args->amount) {
             args->from->value -= args->amount;
             args->to->value += args->amount;
-            printf("%s: Transferred %d from resource %d to resource %d\n",
+            log_printf(stdout, "%s: Transferred %d from resource %d to resource %d\n",
                    args->thread_name, args->amount, args->from->id, args->to->id);
         }
         
-        pthread_mutex_unlock(&second->mutex);
-        pthread_mutex_unlock(&first->mutex);
+        dep_unlock(&second->mutex);
+        dep_unlock(&first->mutex);
         
         usleep(50); // Pequeña pausa entre operaciones
     }
@@ -267,10 +540,11 @@ void test_bank_transfer() {
     pthread_t t1, t2, t3;
     
     TransferArgs args1, args2, args3;
-    args1 = {&account1, &account2, 50, 5, "T1"};
-    args2 = {&account2, &account3, 30, 5, "T2"};
-    args3 = {&account3, &account1, 40, 5, "T3"};
+    args1 = {&account1, &account2, 50, 5, "T1", false};
+    args2 = {&account2, &account3, 30, 5, "T2", false};
+    args3 = {&account3, &account1, 40, 5, "T3", false};
     
+    async_log_barrier();
     double start = now_s();
     
     pthread_create(&t1, nullptr, transfer_worker, &args1);
@@ -282,6 +556,7 @@ void test_bank_transfer() {
     pthread_join(t3, nullptr);
     
     double end = now_s();
+    async_log_barrier();
     
     printf("Final balances: Account1=%d, Account2=%d, Account3=%d\n",
            account1.value, account2.value, account3.value);
@@ -294,7 +569,922 @@ void test_bank_transfer() {
     account3.destroy();
 }
 
+// ---------------------------------------------------------------------------
+// Prueba del validador sobre el codigo real y su costo
+// ---------------------------------------------------------------------------
+
+static void run_dep_thread(void* (*f)(void*), void* arg) {
+    pthread_t t;
+    pthread_create(&t, nullptr, f, arg);
+    pthread_join(t, nullptr);
+}
+
+void test_lockdep() {
+    printf("\n=== Lock Order Validator ===\n");
+    
+    // Los threads del test 2 respetan A -> B: sin reportes
+    pthread_t x, y;
+    pthread_create(&x, nullptr, t1_ordered, nullptr);
+    pthread_create(&y, nullptr, t2_ordered, nullptr);
+    pthread_join(x, nullptr);
+    pthread_join(y, nullptr);
+    async_log_barrier();
+    printf("Test 2 threads (A->B): %ld reports\n", lockdep_reports.load());
+    
+    // t2_deadlock del test 1 solo, despues: nunca hay deadlock real, pero el
+    // orden invertido B -> A se detecta la primera vez que aparece
+    run_dep_thread(t2_deadlock, nullptr);
+    async_log_barrier();
+    printf("Test 1 t2_deadlock alone (B->A, no actual deadlock): %ld reports\n", lockdep_reports.load());
+    
+    // transfer_worker del test 4: dos cuentas siempre por id creciente
+    Resource acct1, acct2;
+    acct1.init(1);
+    acct2.init(2);
+    acct1.value = acct2.value = 100;
+    TransferArgs down = {&acct2, &acct1, 10, 2, "T1", false};
+    run_dep_thread(transfer_worker, &down);
+    async_log_barrier();
+    printf("Test 4 transfer_worker 2->1 (locks 1 then 2): %ld reports\n", lockdep_reports.load());
+    
+    // La misma transferencia con el orden por id roto: toma 2 antes que 1
+    TransferArgs broken = {&acct2, &acct1, 10, 1, "T2", true};
+    run_dep_thread(transfer_worker, &broken);
+    async_log_barrier();
+    printf("Test 4 transfer_worker with ordering regression (locks 2 then 1): %ld reports\n",
+           lockdep_reports.load());
+    acct1.destroy();
+    acct2.destroy();
+    
+    // Costo por par lock/unlock sin contencion
+    const int N = 2000000;
+    pthread_mutex_t plain = PTHREAD_MUTEX_INITIALIZER;
+    
+    double start = now_s();
+    for (int i = 0; i < N; i++) {
+        pthread_mutex_lock(&plain);
+        pthread_mutex_unlock(&plain);
+    }
+    double plain_ns = (now_s() - start) * 1e9 / N;
+    
+    start = now_s();
+    for (int i = 0; i < N; i++) {
+        dep_lock(&A);
+        dep_unlock(&A);
+    }
+    double dep_ns = (now_s() - start) * 1e9 / N;
+    
+    // Anidado: incluye la verificacion de la arista A -> B
+    start = now_s();
+    for (int i = 0; i < N; i++) {
+        dep_lock(&A);
+        dep_lock(&B);
+        dep_unlock(&B);
+        dep_unlock(&A);
+    }
+    double nested_ns = (now_s() - start) * 1e9 / N / 2;
+    
+    printf("Overhead per lock/unlock: plain %.1fns, lockdep %.1fns (+%.1fns), nested %.1fns\n",
+           plain_ns, dep_ns, dep_ns - plain_ns, nested_ns);
+    
+    pthread_mutex_destroy(&plain);
+}
+
+// ---------------------------------------------------------------------------
+// Detector de deadlocks por grafo de espera (wait-for graph)
+// ---------------------------------------------------------------------------
+//
+// Los threads esperan con pthread_mutex_timedlock en intervalos cortos y
+// publican en que lock estan esperando; cada lock publica su dueño. Un thread
+// detector arma el grafo thread -> dueño del lock esperado y busca ciclos.
+// Como cada thread espera a lo sumo un lock, el grafo es funcional y basta
+// seguir la cadena desde cada nodo. Por cada ciclo elige como victima al
+// ultimo thread que empezo a esperar; la victima suelta sus locks, hace
+// backoff y reintenta, y el resto del trabajo continua.
+
+const int WFG_MAX_THREADS = 64;
+const int WFG_WAIT_SLICE_US = 1000;   // Cada cuanto revisa la victima su bandera
+const int WFG_SCAN_US = 500;          // Periodo del detector
+
+struct WfgMutex {
+    pthread_mutex_t m;
+    std::atomic<int> owner;  // Slot del thread dueño o -1
+};
+
+struct alignas(64) WfgThread {
+    std::atomic<int> waiting_on;   // Indice del lock esperado o -1
+    std::atomic<double> wait_start;
+    std::atomic<bool> abort;
+};
+
+struct WaitForGraph {
+    WfgMutex* locks;
+    int nlocks;
+    int nthreads;
+    WfgThread threads[WFG_MAX_THREADS];
+    std::atomic<bool> stop;
+    
+    // Estadisticas del detector
+    long victims;          // Un ciclo detectado = una victima
+    long cycle_threads;    // Suma de largos de ciclo, para el promedio
+    double latency_sum;
+    double latency_max;
+    
+    WaitForGraph(int n_locks, int n_threads) : nlocks(n_locks), nthreads(n_threads), stop(false),
+                                               victims(0), cycle_threads(0), latency_sum(0), latency_max(0) {
+        locks = new WfgMutex[nlocks];
+        for (int i = 0; i < nlocks; i++) {
+            pthread_mutex_init(&locks[i].m, nullptr);
+            locks[i].owner.store(-1);
+        }
+        for (int i = 0; i < WFG_MAX_THREADS; i++) {
+            threads[i].waiting_on.store(-1);
+            threads[i].wait_start.store(0);
+            threads[i].abort.store(false);
+        }
+    }
+    
+    ~WaitForGraph() {
+        for (int i = 0; i < nlocks; i++) {
+            pthread_mutex_destroy(&locks[i].m);
+        }
+        delete[] locks;
+    }
+};
+
+// Espera el mutex como mucho timeout_us. macOS no tiene
+// pthread_mutex_timedlock, asi que ahi se hace polling con trylock.
+static int mutex_timedlock_us(pthread_mutex_t* m, int timeout_us) {
+#ifdef __APPLE__
+    for (int waited = 0; waited < timeout_us; waited += 50) {
+        if (pthread_mutex_trylock(m) == 0) {
+            return 0;
+        }
+        usleep(50);
+    }
+    return ETIMEDOUT;
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += timeout_us * 1000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+    }
+    return pthread_mutex_timedlock(m, &deadline);
+#endif
+}
+
+// Devuelve false si el detector eligio a este thread como victima: el
+// llamador debe soltar todos sus locks y reintentar
+bool wfg_lock(WaitForGraph* g, int tid, int lock) {
+    WfgThread* self = &g->threads[tid];
+    WfgMutex* l = &g->locks[lock];
+    
+    if (pthread_mutex_trylock(&l->m) == 0) {
+        self->abort.store(false, std::memory_order_release);
+        l->owner.store(tid, std::memory_order_release);
+        return true;
+    }
+    
+    // Un abort que quedo de una espera anterior no aplica a esta
+    self->abort.store(false, std::memory_order_release);
+    self->wait_start.store(now_s(), std::memory_order_relaxed);
+    self->waiting_on.store(lock, std::memory_order_release);
+    
+    while (true) {
+        if (mutex_timedlock_us(&l->m, WFG_WAIT_SLICE_US) == 0) {
+            // Dejar de esperar antes de publicarse como dueño: el detector
+            // nunca debe ver waiting_on == lock y owner(lock) == tid a la vez
+            self->waiting_on.store(-1, std::memory_order_release);
+            l->owner.store(tid, std::memory_order_release);
+            self->abort.store(false, std::memory_order_release);
+            return true;
+        }
+        if (self->abort.load(std::memory_order_acquire)) {
+            self->waiting_on.store(-1, std::memory_order_release);
+            self->abort.store(false, std::memory_order_release);
+            return false;
+        }
+    }
+}
+
+void wfg_unlock(WaitForGraph* g, int lock) {
+    WfgMutex* l = &g->locks[lock];
+    l->owner.store(-1, std::memory_order_release);
+    pthread_mutex_unlock(&l->m);
+}
+
+// Una pasada del detector: sigue la cadena de espera desde cada thread
+static void wfg_scan(WaitForGraph* g) {
+    int next[WFG_MAX_THREADS];
+    int waits[WFG_MAX_THREADS];
+    for (int t = 0; t < g->nthreads; t++) {
+        int lock = g->threads[t].waiting_on.load(std::memory_order_acquire);
+        waits[t] = lock;
+        next[t] = lock < 0 ? -1 : g->locks[lock].owner.load(std::memory_order_acquire);
+        // Auto-arista: t acaba de obtener el lock que esperaba
+        if (next[t] == t) {
+            next[t] = -1;
+        }
+    }
+    
+    // 0 = sin visitar, 1 = en la cadena actual, 2 = terminado
+    int state[WFG_MAX_THREADS] = {0};
+    for (int start = 0; start < g->nthreads; start++) {
+        int t = start;
+        while (t >= 0 && state[t] == 0) {
+            state[t] = 1;
+            t = next[t];
+        }
+        
+        if (t >= 0 && state[t] == 1) {
+            // Ciclo que pasa por t: la victima es el ultimo en empezar a esperar
+            int victim = t;
+            double newest = 0;
+            bool pending = false;
+            bool changed = false;
+            int len = 0;
+            int u = t;
+            do {
+                len++;
+                double ws = g->threads[u].wait_start.load(std::memory_order_relaxed);
+                if (ws >= newest) {
+                    newest = ws;
+                    victim = u;
+                }
+                pending |= g->threads[u].abort.load(std::memory_order_relaxed);
+                // Segunda lectura: si alguien dejo de esperar, el ciclo ya no existe
+                changed |= g->threads[u].waiting_on.load(std::memory_order_acquire) != waits[u];
+                u = next[u];
+            } while (u != t && u >= 0);
+            
+            // u < 0 o changed: la cadena cambio mientras se leia; se revisa en la proxima pasada
+            if (u == t && !pending && !changed) {
+                double latency = now_s() - newest;
+                g->victims++;
+                g->cycle_threads += len;
+                g->latency_sum += latency;
+                g->latency_max = std::max(g->latency_max, latency);
+                g->threads[victim].abort.store(true, std::memory_order_release);
+            }
+        }
+        
+        for (t = start; t >= 0 && state[t] == 1; t = next[t]) {
+            state[t] = 2;
+        }
+    }
+}
+
+void* wfg_detector(void* p) {
+    WaitForGraph* g = static_cast<WaitForGraph*>(p);
+    while (!g->stop.load(std::memory_order_acquire)) {
+        wfg_scan(g);
+        usleep(WFG_SCAN_US);
+    }
+    return nullptr;
+}
+
+struct WfgWorkerArgs {
+    WaitForGraph* graph;
+    int tid;
+    int ops;
+    int locks_per_op;
+    long completed;
+    long aborts;
+};
+
+// Toma locks_per_op locks al azar en orden aleatorio (propenso a deadlock)
+void* wfg_worker(void* p) {
+    WfgWorkerArgs* args = static_cast<WfgWorkerArgs*>(p);
+    WaitForGraph* g = args->graph;
+    std::mt19937 gen(args->tid + 1);
+    std::vector<int> want(args->locks_per_op);
+    
+    for (int op = 0; op < args->ops; op++) {
+        // Locks distintos en orden aleatorio
+        for (int i = 0; i < args->locks_per_op; i++) {
+            bool dup;
+            do {
+                want[i] = gen() % g->nlocks;
+                dup = std::find(want.begin(), want.begin() + i, want[i]) != want.begin() + i;
+            } while (dup);
+        }
+        
+        for (int attempt = 0; ; attempt++) {
+            int held = 0;
+            while (held < args->locks_per_op && wfg_lock(g, args->tid, want[held])) {
+                held++;
+            }
+            if (held == args->locks_per_op) {
+                usleep(20); // Seccion critica corta con los locks tomados
+                for (int i = held - 1; i >= 0; i--) {
+                    wfg_unlock(g, want[i]);
+                }
+                break;
+            }
+            
+            // Victima: soltar todo y reintentar con backoff aleatorio creciente
+            for (int i = held - 1; i >= 0; i--) {
+                wfg_unlock(g, want[i]);
+            }
+            args->aborts++;
+            usleep(50 + gen() % (100 << std::min(attempt, 5)));
+        }
+        args->completed++;
+    }
+    return nullptr;
+}
+
+static void run_wfg_workload(const char* label, int nthreads, int nlocks, int ops, int locks_per_op) {
+    WaitForGraph graph(nlocks, nthreads);
+    std::vector<pthread_t> threads(nthreads);
+    std::vector<WfgWorkerArgs> args(nthreads);
+    pthread_t detector;
+    
+    double start = now_s();
+    pthread_create(&detector, nullptr, wfg_detector, &graph);
+    for (int i = 0; i < nthreads; i++) {
+        args[i] = {&graph, i, ops, locks_per_op, 0, 0};
+        pthread_create(&threads[i], nullptr, wfg_worker, &args[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    double end = now_s();
+    graph.stop.store(true);
+    pthread_join(detector, nullptr);
+    
+    long completed = 0;
+    for (int i = 0; i < nthreads; i++) {
+        completed += args[i].completed;
+    }
+    printf("%s: %ld ops in %.3fs (%.0f ops/sec), victims=%ld (avg cycle %.1f threads), "
+           "detection latency avg %.2fms max %.2fms\n",
+           label, completed, end - start, completed / (end - start), graph.victims,
+           graph.victims ? (double)graph.cycle_threads / graph.victims : 0.0,
+           graph.victims ? graph.latency_sum / graph.victims * 1e3 : 0.0, graph.latency_max * 1e3);
+}
+
+struct WfgPairArgs {
+    WaitForGraph* graph;
+    int tid;
+    int first;
+    int second;
+};
+
+// Igual que t1_deadlock/t2_deadlock, pero la victima suelta y reintenta
+void* wfg_pair_worker(void* p) {
+    WfgPairArgs* args = static_cast<WfgPairArgs*>(p);
+    WaitForGraph* g = args->graph;
+    
+    for (int attempt = 1; ; attempt++) {
+        if (!wfg_lock(g, args->tid, args->first)) {
+            // No se tiene ningun lock: solo esperar y reintentar
+            usleep(1000 * attempt);
+            continue;
+        }
+        usleep(1000); // Dar oportunidad al otro thread de tomar su primer lock
+        if (wfg_lock(g, args->tid, args->second)) {
+            printf("T%d: Got both locks on attempt %d\n", args->tid + 1, attempt);
+            wfg_unlock(g, args->second);
+            wfg_unlock(g, args->first);
+            return nullptr;
+        }
+        printf("T%d: Chosen as deadlock victim, releasing and retrying\n", args->tid + 1);
+        wfg_unlock(g, args->first);
+        usleep(1000 * attempt);
+    }
+}
+
+void test_wait_for_graph(int argc, char** argv) {
+    printf("\n=== Wait-For Graph Deadlock Detector ===\n");
+    
+    // Deadlock ABBA clasico: ahora termina en vez de matar el proceso
+    {
+        WaitForGraph graph(2, 2);
+        pthread_t detector, x, y;
+        WfgPairArgs a1 = {&graph, 0, 0, 1};
+        WfgPairArgs a2 = {&graph, 1, 1, 0};
+        double start = now_s();
+        pthread_create(&detector, nullptr, wfg_detector, &graph);
+        pthread_create(&x, nullptr, wfg_pair_worker, &a1);
+        pthread_create(&y, nullptr, wfg_pair_worker, &a2);
+        pthread_join(x, nullptr);
+        pthread_join(y, nullptr);
+        graph.stop.store(true);
+        pthread_join(detector, nullptr);
+        printf("ABBA pair: both threads completed in %.3fs, victims=%ld\n",
+               now_s() - start, graph.victims);
+    }
+    
+    int nthreads = (argc > 2) ? std::atoi(argv[2]) : 8;
+    int nlocks = (argc > 3) ? std::atoi(argv[3]) : 16;
+    int ops = (argc > 4) ? std::atoi(argv[4]) : 1000;
+    nthreads = std::max(1, std::min(nthreads, WFG_MAX_THREADS));
+    
+    // Cada operacion toma locks distintos: hacen falta al menos tantos locks
+    if (nlocks < 2) {
+        printf("Need at least 2 locks\n");
+        return;
+    }
+    
+    printf("\nRandomized workload (Threads: %d, Locks: %d, Ops/thread: %d)\n", nthreads, nlocks, ops);
+    run_wfg_workload("2 locks/op", nthreads, nlocks, ops, 2);
+    if (nlocks >= 3) {
+        run_wfg_workload("3 locks/op", nthreads, nlocks, ops, 3);
+    } else {
+        printf("3 locks/op: skipped, needs at least 3 locks\n");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark de trylock con muchos threads y muchos locks por politica
+// ---------------------------------------------------------------------------
+
+const int LIVELOCK_THRESHOLD = 10;  // Mismo limite de intentos que t1_trylock
+
+struct TrylockArgs {
+    pthread_mutex_t* locks;
+    int nlocks;
+    BackoffKind kind;
+    int tid;
+    const std::atomic<bool>* stop;
+    long successes;
+    long failures;
+    long livelocks;    // Operaciones que superaron LIVELOCK_THRESHOLD fallos seguidos
+};
+
+void* trylock_worker(void* p) {
+    TrylockArgs* args = static_cast<TrylockArgs*>(p);
+    std::mt19937 gen(args->tid + 1);
+    Backoff backoff;
+    backoff.init(args->kind, 20, 5000, args->tid + 1);
+    
+    while (!args->stop->load(std::memory_order_acquire)) {
+        // Dos locks distintos en orden aleatorio: sin orden global
+        int a = gen() % args->nlocks;
+        int b = gen() % args->nlocks;
+        while (b == a) {
+            b = gen() % args->nlocks;
+        }
+        
+        int consecutive = 0;
+        while (!args->stop->load(std::memory_order_acquire)) {
+            pthread_mutex_lock(&args->locks[a]);
+            if (pthread_mutex_trylock(&args->locks[b]) == 0) {
+                for (volatile int spin = 0; spin < 200; spin++) {
+                } // Seccion critica corta
+                pthread_mutex_unlock(&args->locks[b]);
+                pthread_mutex_unlock(&args->locks[a]);
+                backoff.on_success();
+                args->successes++;
+                break;
+            }
+            pthread_mutex_unlock(&args->locks[a]);
+            args->failures++;
+            if (++consecutive == LIVELOCK_THRESHOLD) {
+                args->livelocks++;
+            }
+            usleep(backoff.on_failure());
+        }
+    }
+    return nullptr;
+}
+
+void test_backoff_policies(int argc, char** argv) {
+    int nthreads = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int nlocks = (argc > 3) ? std::atoi(argv[3]) : 8;
+    double duration = (argc > 4) ? std::atof(argv[4]) : 0.5;
+    
+    // Cada operacion toma dos locks distintos
+    if (nthreads < 1 || nlocks < 2) {
+        printf("Need at least 1 thread and 2 locks\n");
+        return;
+    }
+    
+    printf("\n=== Trylock Backoff Policies (Threads: %d, Locks: %d, %.1fs each) ===\n",
+           nthreads, nlocks, duration);
+    
+    const BackoffKind kinds[] = {BACKOFF_FIXED, BACKOFF_EXPONENTIAL, BACKOFF_FULL_JITTER,
+                                 BACKOFF_DECORRELATED, BACKOFF_ADAPTIVE};
+    
+    for (BackoffKind kind : kinds) {
+        std::vector<pthread_mutex_t> locks(nlocks);
+        for (auto& l : locks) {
+            pthread_mutex_init(&l, nullptr);
+        }
+        std::vector<pthread_t> threads(nthreads);
+        std::vector<TrylockArgs> args(nthreads);
+        std::atomic<bool> stop(false);
+        
+        double start = now_s();
+        for (int i = 0; i < nthreads; i++) {
+            args[i] = {locks.data(), nlocks, kind, i, &stop, 0, 0, 0};
+            pthread_create(&threads[i], nullptr, trylock_worker, &args[i]);
+        }
+        usleep((useconds_t)(duration * 1e6));
+        stop.store(true, std::memory_order_release);
+        for (int i = 0; i < nthreads; i++) {
+            pthread_join(threads[i], nullptr);
+        }
+        double elapsed = now_s() - start;
+        
+        // Justicia: coeficiente de variacion e indice de Jain de los exitos por thread
+        long successes = 0, failures = 0, livelocks = 0;
+        double sum = 0, sum_sq = 0;
+        for (int i = 0; i < nthreads; i++) {
+            successes += args[i].successes;
+            failures += args[i].failures;
+            livelocks += args[i].livelocks;
+            sum += args[i].successes;
+            sum_sq += (double)args[i].successes * args[i].successes;
+        }
+        double mean = sum / nthreads;
+        double variance = sum_sq / nthreads - mean * mean;
+        double cv = mean > 0 ? std::sqrt(std::max(variance, 0.0)) / mean : 0;
+        double jain = sum_sq > 0 ? sum * sum / (nthreads * sum_sq) : 0;
+        
+        printf("%-13s %.0f ops/sec, fail ratio %.2f, per-thread CV %.3f, Jain %.3f, livelocks %ld\n",
+               backoff_name(kind), successes / elapsed,
+               successes + failures ? (double)failures / (successes + failures) : 0.0,
+               cv, jain, livelocks);
+        
+        for (auto& l : locks) {
+            pthread_mutex_destroy(&l);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Motor de transferencias escalable: N cuentas, M threads
+// ---------------------------------------------------------------------------
+
+enum AccountDist {
+    DIST_UNIFORM,
+    DIST_SKEWED   // Zipf: pocas cuentas calientes reciben la mayoria del trafico
+};
+
+enum TransferMode {
+    TRANSFER_ORDERED,     // Dos mutex en orden de id
+    TRANSFER_OPTIMISTIC,  // Lecturas sin lock y validacion al commit (estilo TL2)
+    TRANSFER_COMBINING    // Flat combining: un thread aplica lotes de transferencias
+};
+
+struct EngineConfig {
+    int accounts;
+    int threads;
+    long transfers;     // Por thread
+    AccountDist dist;
+    double zipf_theta;  // Solo DIST_SKEWED
+    bool lockdep;       // Validar el orden de los locks de cuenta
+    TransferMode mode;
+};
+
+struct EngineStats {
+    long committed;     // Transferencias aplicadas
+    long aborted;       // Rechazadas por fondos insuficientes
+    long self_redraws;  // Sorteos repetidos porque origen == destino (no es contencion)
+    long conflicts;     // Transacciones optimistas reintentadas por conflicto
+    double fc_batch;    // Transferencias por turno de combinador
+    double seconds;
+    long total_before;
+    long total_after;
+};
+
+const int INITIAL_BALANCE = 1000;
+
+// Selector de cuentas: uniforme o Zipf por CDF precalculada (busqueda binaria)
+struct AccountPicker {
+    AccountDist dist;
+    int accounts;
+    std::vector<double> cdf;
+    
+    AccountPicker(AccountDist d, int n, double theta) : dist(d), accounts(n) {
+        if (dist == DIST_SKEWED) {
+            cdf.resize(n);
+            double sum = 0;
+            for (int i = 0; i < n; i++) {
+                sum += 1.0 / std::pow(i + 1, theta);
+                cdf[i] = sum;
+            }
+            for (int i = 0; i < n; i++) {
+                cdf[i] /= sum;
+            }
+        }
+    }
+    
+    int pick(std::mt19937_64& gen) const {
+        if (dist == DIST_UNIFORM) {
+            return gen() % accounts;
+        }
+        double u = std::generate_canonical<double, 53>(gen);
+        int idx = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(idx, accounts - 1);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Transacciones optimistas (TL2): reloj global de versiones y un version-lock
+// por cuenta. Las lecturas no toman locks; el commit bloquea solo el write set,
+// valida contra la version leida y publica con una nueva version.
+// ---------------------------------------------------------------------------
+
+static std::atomic<uint64_t> stm_clock{0};
+
+const int STM_LOCK_SPINS = 64;   // Intentos de tomar un version-lock antes de abortar
+
+// Lectura consistente de una cuenta: falla si esta bloqueada o si cambio
+// despues de que la transaccion tomo su version de lectura rv
+static bool stm_read(Resource* r, uint64_t rv, int* out) {
+    // Seqlock sin fences (TSan no los modela): la carga acquire del valor
+    // ordena la segunda lectura de vlock despues de ella, y como el commit
+    // publica el valor con release, ver un valor nuevo implica ver el lock
+    uint64_t v1 = r->vlock.load(std::memory_order_acquire);
+    int value = __atomic_load_n(&r->value, __ATOMIC_ACQUIRE);
+    uint64_t v2 = r->vlock.load(std::memory_order_relaxed);
+    if ((v1 & 1) || v1 != v2 || (v1 >> 1) > rv) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+static bool stm_lock(Resource* r, uint64_t rv) {
+    for (int spin = 0; spin < STM_LOCK_SPINS; spin++) {
+        uint64_t v = r->vlock.load(std::memory_order_relaxed);
+        if (v & 1) {
+            continue;
+        }
+        // Si alguien ya publico una version mas nueva, lo leido es viejo
+        if ((v >> 1) > rv) {
+            return false;
+        }
+        if (r->vlock.compare_exchange_weak(v, v | 1, std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void stm_unlock(Resource* r, uint64_t version) {
+    r->vlock.store(version << 1, std::memory_order_release);
+}
+
+// Devuelve 1 si aplico la transferencia, 0 si no habia fondos y -1 si hubo conflicto
+static int transfer_optimistic(Resource* a, Resource* b, int amount) {
+    uint64_t rv = stm_clock.load(std::memory_order_acquire);
+    int va, vb;
+    if (!stm_read(a, rv, &va) || !stm_read(b, rv, &vb)) {
+        return -1;
+    }
+    if (va < amount) {
+        return 0;   // Solo lectura: las lecturas ya fueron validadas contra rv
+    }
+    
+    // Write set == read set; se bloquea en orden de id y sin esperas largas
+    Resource* first = (a->id < b->id) ? a : b;
+    Resource* second = (a->id < b->id) ? b : a;
+    if (!stm_lock(first, rv)) {
+        return -1;
+    }
+    if (!stm_lock(second, rv)) {
+        stm_unlock(first, first->vlock.load(std::memory_order_relaxed) >> 1);
+        return -1;
+    }
+    
+    uint64_t wv = stm_clock.fetch_add(1, std::memory_order_acq_rel) + 1;
+    // stm_lock ya comprobo version <= rv con el lock tomado, asi que el read set es valido
+    __atomic_store_n(&a->value, va - amount, __ATOMIC_RELEASE);
+    __atomic_store_n(&b->value, vb + amount, __ATOMIC_RELEASE);
+    stm_unlock(second, wv);
+    stm_unlock(first, wv);
+    return 1;
+}
+
+// Transferencia publicada en el combinador; result: 1 aplicada, 0 sin fondos
+struct TransferOp {
+    int from;
+    int to;
+    int amount;
+    int result;
+};
+
+// Con flat combining las cuentas son una estructura secuencial: solo el
+// combinador las toca, asi que no se usan sus mutex
+struct TransferApply {
+    Resource* accounts;
+    void operator()(TransferOp& op) {
+        Resource* a = &accounts[op.from];
+        if (a->value >= op.amount) {
+            a->value -= op.amount;
+            accounts[op.to].value += op.amount;
+            op.result = 1;
+        } else {
+            op.result = 0;
+        }
+    }
+};
+
+typedef FlatCombiner<TransferOp, TransferApply> TransferCombiner;
+
+struct EngineArgs {
+    Resource* accounts;
+    const AccountPicker* picker;
+    bool lockdep;
+    TransferMode mode;
+    TransferCombiner* combiner;
+    long transfers;
+    int thread_id;
+    long committed;
+    long aborted;
+    long self_redraws;
+    long conflicts;
+};
+
+// Transferencia con adquisicion ordenada de dos locks y sin I/O en la seccion critica
+void* engine_worker(void* p) {
+    EngineArgs* args = static_cast<EngineArgs*>(p);
+    std::mt19937_64 gen(args->thread_id * 7919 + 1);
+    long committed = 0, aborted = 0, self_redraws = 0, conflicts = 0;
+    
+    for (long i = 0; i < args->transfers; i++) {
+        int from = args->picker->pick(gen);
+        int to = args->picker->pick(gen);
+        while (to == from) {
+            to = args->picker->pick(gen);
+            self_redraws++;
+        }
+        int amount = 1 + gen() % 100;
+        
+        Resource* a = &args->accounts[from];
+        Resource* b = &args->accounts[to];
+        
+        if (args->mode == TRANSFER_OPTIMISTIC) {
+            int result;
+            while ((result = transfer_optimistic(a, b, amount)) < 0) {
+                conflicts++;
+                sched_yield();
+            }
+            if (result) {
+                committed++;
+            } else {
+                aborted++;
+            }
+            continue;
+        }
+        
+        if (args->mode == TRANSFER_COMBINING) {
+            TransferOp op = {from, to, amount, 0};
+            args->combiner->execute(args->thread_id, op);
+            if (op.result) {
+                committed++;
+            } else {
+                aborted++;
+            }
+            continue;
+        }
+        
+        Resource* first = (a->id < b->id) ? a : b;
+        Resource* second = (a->id < b->id) ? b : a;
+        
+        if (args->lockdep) {
+            dep_lock(&first->mutex);
+            dep_lock(&second->mutex);
+        } else {
+            pthread_mutex_lock(&first->mutex.m);
+            pthread_mutex_lock(&second->mutex.m);
+        }
+        if (a->value >= amount) {
+            a->value -= amount;
+            b->value += amount;
+            committed++;
+        } else {
+            aborted++;
+        }
+        if (args->lockdep) {
+            dep_unlock(&second->mutex);
+            dep_unlock(&first->mutex);
+        } else {
+            pthread_mutex_unlock(&second->mutex.m);
+            pthread_mutex_unlock(&first->mutex.m);
+        }
+    }
+    
+    args->committed = committed;
+    args->aborted = aborted;
+    args->self_redraws = self_redraws;
+    args->conflicts = conflicts;
+    return nullptr;
+}
+
+EngineStats run_transfer_engine(const EngineConfig& cfg) {
+    std::vector<Resource> accounts(cfg.accounts);
+    long total_before = 0;
+    for (int i = 0; i < cfg.accounts; i++) {
+        accounts[i].init(i);
+        accounts[i].value = INITIAL_BALANCE;
+        total_before += accounts[i].value;
+    }
+    
+    AccountPicker picker(cfg.dist, cfg.accounts, cfg.zipf_theta);
+    TransferCombiner combiner(cfg.threads, TransferApply{accounts.data()});
+    std::vector<pthread_t> threads(cfg.threads);
+    std::vector<EngineArgs> args(cfg.threads);
+    
+    double start = now_s();
+    for (int i = 0; i < cfg.threads; i++) {
+        args[i] = {accounts.data(), &picker, cfg.lockdep, cfg.mode, &combiner,
+                   cfg.transfers, i, 0, 0, 0, 0};
+        pthread_create(&threads[i], nullptr, engine_worker, &args[i]);
+    }
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    double end = now_s();
+    
+    EngineStats stats = {0, 0, 0, 0, 0, end - start, total_before, 0};
+    for (int i = 0; i < cfg.threads; i++) {
+        stats.committed += args[i].committed;
+        stats.aborted += args[i].aborted;
+        stats.self_redraws += args[i].self_redraws;
+        stats.conflicts += args[i].conflicts;
+    }
+    stats.fc_batch = combiner.avg_batch();
+    for (int i = 0; i < cfg.accounts; i++) {
+        stats.total_after += accounts[i].value;
+        accounts[i].destroy();
+    }
+    return stats;
+}
+
+static void print_engine_stats(const char* label, const EngineStats& st) {
+    long attempts = st.committed + st.aborted;
+    printf("%-16s %.3fs, %.0f transfers/sec, %.0f commits/sec, committed=%ld aborted=%ld "
+           "self_redraws=%ld, conflict aborts=%ld (%.2f%%), balance %ld -> %ld %s\n",
+           label, st.seconds, attempts / st.seconds, st.committed / st.seconds,
+           st.committed, st.aborted, st.self_redraws, st.conflicts,
+           100.0 * st.conflicts / (attempts + st.conflicts),
+           st.total_before, st.total_after,
+           st.total_before == st.total_after ? "[OK]" : "[INVARIANT BROKEN]");
+}
+
+void test_transfer_engine(int argc, char** argv) {
+    EngineConfig cfg;
+    cfg.accounts = (argc > 2) ? std::atoi(argv[2]) : 1000;
+    cfg.threads = (argc > 3) ? std::atoi(argv[3]) : 4;
+    cfg.transfers = (argc > 4) ? std::atol(argv[4]) : 200000;
+    cfg.zipf_theta = (argc > 5) ? std::atof(argv[5]) : 0.99;
+    
+    if (cfg.accounts < 2 || cfg.threads < 1 || cfg.transfers < 1) {
+        printf("Need at least 2 accounts, 1 thread and 1 transfer\n");
+        return;
+    }
+    
+    printf("\n=== Transfer Engine (Accounts: %d, Threads: %d, Transfers/thread: %ld) ===\n",
+           cfg.accounts, cfg.threads, cfg.transfers);
+    
+    cfg.lockdep = false;
+    cfg.mode = TRANSFER_ORDERED;
+    cfg.dist = DIST_UNIFORM;
+    print_engine_stats("UNIFORM:", run_transfer_engine(cfg));
+    
+    // Mismo escenario con el validador encendido (orden por id de cuenta),
+    // para ver su costo real
+    cfg.lockdep = true;
+    print_engine_stats("+LOCKDEP:", run_transfer_engine(cfg));
+    cfg.lockdep = false;
+    
+    cfg.dist = DIST_SKEWED;
+    char label[32];
+    snprintf(label, sizeof(label), "ZIPF(%.2f):", cfg.zipf_theta);
+    print_engine_stats(label, run_transfer_engine(cfg));
+    
+    // Mismas distribuciones con transacciones optimistas
+    cfg.mode = TRANSFER_OPTIMISTIC;
+    cfg.dist = DIST_UNIFORM;
+    print_engine_stats("STM UNIFORM:", run_transfer_engine(cfg));
+    cfg.dist = DIST_SKEWED;
+    snprintf(label, sizeof(label), "STM ZIPF(%.2f):", cfg.zipf_theta);
+    print_engine_stats(label, run_transfer_engine(cfg));
+    
+    // Flat combining: conviene cuando pocas cuentas concentran el trafico
+    cfg.mode = TRANSFER_COMBINING;
+    cfg.dist = DIST_UNIFORM;
+    EngineStats fc = run_transfer_engine(cfg);
+    print_engine_stats("FC UNIFORM:", fc);
+    printf("%-16s %.2f transfers per combiner turn\n", "", fc.fc_batch);
+    cfg.dist = DIST_SKEWED;
+    snprintf(label, sizeof(label), "FC ZIPF(%.2f):", cfg.zipf_theta);
+    fc = run_transfer_engine(cfg);
+    print_engine_stats(label, fc);
+    printf("%-16s %.2f transfers per combiner turn\n", "", fc.fc_batch);
+}
+
 int main(int argc, char** argv) {
+    argc = parse_log_flag(argc, argv);
+    async_log_start();
+    
     if (argc > 1) {
         int test_type = std::atoi(argv[1]);
         
@@ -311,17 +1501,34 @@ int main(int argc, char** argv) {
             case 4:
                 test_bank_transfer();
                 break;
+            case 5:
+                test_transfer_engine(argc, argv);
+                break;
+            case 6:
+                test_lockdep();
+                break;
+            case 7:
+                test_wait_for_graph(argc, argv);
+                break;
+            case 8:
+                test_backoff_policies(argc, argv);
+                break;
             default:
-                printf("Invalid test type. Use 1-4.\n");
+                printf("Invalid test type. Use 1-8.\n");
+                async_log_stop();
                 return 1;
         }
     } else {
         printf("Deadlock Detection and Prevention Demo\n");
-        printf("Usage: %s <test_type>\n", argv[0]);
+        printf("Usage: %s <test_type> [--sync-log]\n", argv[0]);
         printf("  1: Demonstrate deadlock\n");
         printf("  2: Fixed with ordered locks\n");
         printf("  3: Fixed with trylock and backoff\n");
         printf("  4: Bank transfer simulation\n");
+        printf("  5: Transfer engine [accounts] [threads] [transfers_per_thread] [zipf_theta]\n");
+        printf("  6: Lock order validator (lockdep) and its overhead\n");
+        printf("  7: Wait-for graph deadlock detector [threads] [locks] [ops_per_thread]\n");
+        printf("  8: Trylock backoff policies [threads] [locks] [seconds_per_policy]\n");
         printf("\nRunning safe tests only (2, 3, 4)...\n");
         
         test_deadlock_scenario("ORDERED LOCKS", t1_ordered, t2_ordered);
@@ -329,8 +1536,11 @@ int main(int argc, char** argv) {
         test_bank_transfer();
     }
     
-    pthread_mutex_destroy(&A);
-    pthread_mutex_destroy(&B);
+    async_log_stop();
+    print_async_log_stats();
+    
+    A.destroy();
+    B.destroy();
     
     return 0;
 }
@@ -2,7 +2,7 @@
 // Autor: Fatima Navarro
 // Carnet: 24044
 // Fecha: 29/08/2025
-// Propósito: Pipeline de 3 etapas con pthread_barrier y pthread_once
+// Propósito: Pipeline de 3 etapas con barreras intercambiables y pthread_once
 
 #include <pthread.h>
 #include <cstdio>
@@ -11,14 +11,130 @@
 #include <vector>
 #include <random>
 #include <unistd.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include "async_log.hpp"
+#include "simd_filter.hpp"
+#include "batch_rng.hpp"
+#include "stage_pipeline.hpp"
+#include "work_stealing.hpp"
+#include "coro_pipeline.hpp"
 
-// Definir constante para macOS
-#ifndef PTHREAD_BARRIER_SERIAL_THREAD
-#define PTHREAD_BARRIER_SERIAL_THREAD 1
+// TSan no soporta crear threads en un hijo de fork() de un proceso que ya
+// tiene threads (el flusher del logger, si algo ya se registro), asi que los
+// tests que miden cada corrida en un hijo corren en el mismo proceso bajo TSan
+#if defined(__SANITIZE_THREAD__)
+#define P5_UNDER_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define P5_UNDER_TSAN 1
 #endif
+#endif
+
+// ---------------------------------------------------------------------------
+// operator new con contador: cuenta toda reserva dinamica del programa (STL,
+// new/delete explicitos) para comprobar que el pool de lotes no asigna nada
+// en estado estable. malloc directo (printf, glibc) no pasa por aqui.
+// ---------------------------------------------------------------------------
+
+static std::atomic<long> heap_allocs(0);
+static std::atomic<long> heap_bytes(0);
+
+static void* counted_alloc(size_t size, size_t align) {
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) {
+        p = std::malloc(size ? size : 1);
+    } else if (posix_memalign(&p, align, size ? size : 1) != 0) {
+        p = nullptr;
+    }
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return counted_alloc(size, 0); }
+void* operator new[](size_t size) { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return counted_alloc(size, (size_t)al); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_alloc(size, (size_t)al); }
+
+// noinline: si gcc inlinea estos free() junto al new del llamador avisa
+// -Wmismatched-new-delete (con -O1 de los sanitizers), aunque el par es valido
+#define COUNTED_DELETE __attribute__((noinline))
+
+COUNTED_DELETE void operator delete(void* p) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete[](void* p) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete(void* p, size_t) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete[](void* p, size_t) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+COUNTED_DELETE void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+// ---------------------------------------------------------------------------
+// Barreras intercambiables para los ticks del pipeline
+// ---------------------------------------------------------------------------
+
+enum BarrierKind {
+    BARRIER_NATIVE,          // pthread_barrier_t de glibc (en macOS cae a condvar)
+    BARRIER_CONDVAR,         // Mutex + broadcast: la implementacion original
+    BARRIER_SENSE,           // Centralizada con inversion de sentido
+    BARRIER_TREE,            // Arbol de combinacion (fan-in 4)
+    BARRIER_DISSEMINATION    // log2(n) rondas de señales entre pares
+};
+
+const char* barrier_name(BarrierKind kind) {
+    switch (kind) {
+        case BARRIER_NATIVE: return "native";
+        case BARRIER_CONDVAR: return "condvar";
+        case BARRIER_SENSE: return "sense";
+        case BARRIER_TREE: return "tree";
+        case BARRIER_DISSEMINATION: return "dissemination";
+    }
+    return "?";
+}
 
-// Implementación manual de barrier para macOS
-struct pthread_barrier_t {
+bool parse_barrier_kind(const char* name, BarrierKind* kind) {
+    const BarrierKind kinds[] = {BARRIER_NATIVE, BARRIER_CONDVAR, BARRIER_SENSE,
+                                 BARRIER_TREE, BARRIER_DISSEMINATION};
+    for (BarrierKind k : kinds) {
+        if (strcmp(name, barrier_name(k)) == 0) {
+            *kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+const int BARRIER_MAX_THREADS = 64;
+const int BARRIER_TREE_FANIN = 4;
+const int BARRIER_MAX_ROUNDS = 6;     // ceil(log2(64))
+const int SPINS_BEFORE_YIELD = 128;
+
+// Espera activa breve y luego cede el CPU: con mas threads que cores un
+// spin puro nunca deja correr al thread que falta
+template <typename Done>
+inline void spin_until(Done done) {
+    int spins = 0;
+    while (!done()) {
+        if (++spins >= SPINS_BEFORE_YIELD) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+// Barrera con mutex y condvar (portable, era el reemplazo para macOS)
+struct CondBarrier {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int count;
@@ -26,16 +142,15 @@ struct pthread_barrier_t {
     int generation;
 };
 
-int pthread_barrier_init(pthread_barrier_t* barrier, void* attr, unsigned int count) {
+void cond_barrier_init(CondBarrier* barrier, int count) {
     barrier->count = 0;
     barrier->tripCount = count;
     barrier->generation = 0;
     pthread_mutex_init(&barrier->mutex, nullptr);
     pthread_cond_init(&barrier->cond, nullptr);
-    return 0;
 }
 
-int pthread_barrier_wait(pthread_barrier_t* barrier) {
+void cond_barrier_wait(CondBarrier* barrier) {
     pthread_mutex_lock(&barrier->mutex);
     int gen = barrier->generation;
     
@@ -45,20 +160,253 @@ int pthread_barrier_wait(pthread_barrier_t* barrier) {
         barrier->count = 0;
         pthread_cond_broadcast(&barrier->cond);
         pthread_mutex_unlock(&barrier->mutex);
-        return PTHREAD_BARRIER_SERIAL_THREAD;
+        return;
     }
     
     while (gen == barrier->generation) {
         pthread_cond_wait(&barrier->cond, &barrier->mutex);
     }
     pthread_mutex_unlock(&barrier->mutex);
-    return 0;
 }
 
-int pthread_barrier_destroy(pthread_barrier_t* barrier) {
+void cond_barrier_destroy(CondBarrier* barrier) {
     pthread_mutex_destroy(&barrier->mutex);
     pthread_cond_destroy(&barrier->cond);
-    return 0;
+}
+
+// Sentido local por thread, cada uno en su propia linea
+struct alignas(64) LocalSense {
+    bool sense;
+};
+
+// Centralizada: el ultimo en llegar reinicia el contador e invierte el
+// sentido global; los demas esperan leyendo una sola variable
+struct SenseBarrier {
+    alignas(64) std::atomic<int> count;
+    alignas(64) std::atomic<bool> sense;
+    int n;
+    LocalSense local[BARRIER_MAX_THREADS];
+};
+
+void sense_barrier_init(SenseBarrier* b, int n) {
+    b->count.store(n);
+    b->sense.store(false);
+    b->n = n;
+    for (int i = 0; i < n; i++) {
+        b->local[i].sense = false;
+    }
+}
+
+void sense_barrier_wait(SenseBarrier* b, int tid) {
+    bool my_sense = !b->local[tid].sense;
+    b->local[tid].sense = my_sense;
+    if (b->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        b->count.store(b->n, std::memory_order_relaxed);
+        b->sense.store(my_sense, std::memory_order_release);
+    } else {
+        spin_until([&] { return b->sense.load(std::memory_order_acquire) == my_sense; });
+    }
+}
+
+// Arbol de combinacion: cada nodo cuenta a lo sumo FANIN llegadas y solo el
+// ultimo sube al padre, asi ningun contador recibe mas de FANIN escrituras.
+// El que completa la raiz libera a todos invirtiendo el sentido global.
+struct alignas(64) TreeNode {
+    std::atomic<int> count;
+    int fanin;
+    int parent;    // -1 en la raiz
+};
+
+struct TreeBarrier {
+    TreeNode nodes[2 * BARRIER_MAX_THREADS];
+    int leaf_of[BARRIER_MAX_THREADS];
+    alignas(64) std::atomic<bool> sense;
+    LocalSense local[BARRIER_MAX_THREADS];
+};
+
+void tree_barrier_init(TreeBarrier* b, int n) {
+    // Nivel 0: hojas con hasta FANIN threads; cada nivel agrupa FANIN nodos
+    int level_start = 0;
+    int level_size = (n + BARRIER_TREE_FANIN - 1) / BARRIER_TREE_FANIN;
+    for (int i = 0; i < n; i++) {
+        b->leaf_of[i] = i / BARRIER_TREE_FANIN;
+        b->local[i].sense = false;
+    }
+    for (int i = 0; i < level_size; i++) {
+        int members = std::min(BARRIER_TREE_FANIN, n - i * BARRIER_TREE_FANIN);
+        b->nodes[i].fanin = members;
+    }
+    while (level_size > 1) {
+        int next_start = level_start + level_size;
+        int next_size = (level_size + BARRIER_TREE_FANIN - 1) / BARRIER_TREE_FANIN;
+        for (int i = 0; i < level_size; i++) {
+            b->nodes[level_start + i].parent = next_start + i / BARRIER_TREE_FANIN;
+        }
+        for (int i = 0; i < next_size; i++) {
+            b->nodes[next_start + i].fanin =
+                std::min(BARRIER_TREE_FANIN, level_size - i * BARRIER_TREE_FANIN);
+        }
+        level_start = next_start;
+        level_size = next_size;
+    }
+    b->nodes[level_start].parent = -1;
+    for (int i = 0; i <= level_start; i++) {
+        b->nodes[i].count.store(b->nodes[i].fanin);
+    }
+    b->sense.store(false);
+}
+
+void tree_barrier_wait(TreeBarrier* b, int tid) {
+    bool my_sense = !b->local[tid].sense;
+    b->local[tid].sense = my_sense;
+    
+    int node = b->leaf_of[tid];
+    while (true) {
+        TreeNode& nd = b->nodes[node];
+        if (nd.count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            break;   // No fue el ultimo en este nodo
+        }
+        nd.count.store(nd.fanin, std::memory_order_relaxed);
+        if (nd.parent < 0) {
+            b->sense.store(my_sense, std::memory_order_release);
+            return;
+        }
+        node = nd.parent;
+    }
+    spin_until([&] { return b->sense.load(std::memory_order_acquire) == my_sense; });
+}
+
+// Diseminacion: en la ronda r el thread i avisa a (i + 2^r) % n y espera el
+// aviso de (i - 2^r) % n. Sin contador compartido; dos juegos de banderas
+// (paridad) evitan que un episodio pise al siguiente.
+struct alignas(64) DissemFlags {
+    std::atomic<bool> flag[2][BARRIER_MAX_ROUNDS];
+    int parity;
+    bool sense;
+};
+
+struct DisseminationBarrier {
+    int n;
+    int rounds;
+    DissemFlags threads[BARRIER_MAX_THREADS];
+};
+
+void dissemination_barrier_init(DisseminationBarrier* b, int n) {
+    b->n = n;
+    b->rounds = 0;
+    while ((1 << b->rounds) < n) {
+        b->rounds++;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int p = 0; p < 2; p++) {
+            for (int r = 0; r < BARRIER_MAX_ROUNDS; r++) {
+                b->threads[i].flag[p][r].store(false);
+            }
+        }
+        b->threads[i].parity = 0;
+        b->threads[i].sense = true;
+    }
+}
+
+void dissemination_barrier_wait(DisseminationBarrier* b, int tid) {
+    DissemFlags& me = b->threads[tid];
+    int parity = me.parity;
+    bool sense = me.sense;
+    for (int r = 0; r < b->rounds; r++) {
+        DissemFlags& partner = b->threads[(tid + (1 << r)) % b->n];
+        partner.flag[parity][r].store(sense, std::memory_order_release);
+        spin_until([&] { return me.flag[parity][r].load(std::memory_order_acquire) == sense; });
+    }
+    if (parity == 1) {
+        me.sense = !sense;
+    }
+    me.parity = 1 - parity;
+}
+
+// Barrera seleccionable; tid va de 0 a n-1 y es estable por thread
+struct StageBarrier {
+    BarrierKind kind;
+#ifndef __APPLE__
+    pthread_barrier_t native;
+#endif
+    CondBarrier cond;
+    SenseBarrier* sense;
+    TreeBarrier* tree;
+    DisseminationBarrier* dissem;
+};
+
+void stage_barrier_init(StageBarrier* b, BarrierKind kind, int n) {
+#ifdef __APPLE__
+    if (kind == BARRIER_NATIVE) {
+        kind = BARRIER_CONDVAR;   // macOS no tiene pthread_barrier_t
+    }
+#endif
+    b->kind = kind;
+    b->sense = nullptr;
+    b->tree = nullptr;
+    b->dissem = nullptr;
+    switch (kind) {
+        case BARRIER_NATIVE:
+#ifndef __APPLE__
+            pthread_barrier_init(&b->native, nullptr, n);
+#endif
+            break;
+        case BARRIER_CONDVAR:
+            cond_barrier_init(&b->cond, n);
+            break;
+        case BARRIER_SENSE:
+            b->sense = new SenseBarrier();
+            sense_barrier_init(b->sense, n);
+            break;
+        case BARRIER_TREE:
+            b->tree = new TreeBarrier();
+            tree_barrier_init(b->tree, n);
+            break;
+        case BARRIER_DISSEMINATION:
+            b->dissem = new DisseminationBarrier();
+            dissemination_barrier_init(b->dissem, n);
+            break;
+    }
+}
+
+void stage_barrier_wait(StageBarrier* b, int tid) {
+    switch (b->kind) {
+        case BARRIER_NATIVE:
+#ifndef __APPLE__
+            pthread_barrier_wait(&b->native);
+#endif
+            break;
+        case BARRIER_CONDVAR:
+            cond_barrier_wait(&b->cond);
+            break;
+        case BARRIER_SENSE:
+            sense_barrier_wait(b->sense, tid);
+            break;
+        case BARRIER_TREE:
+            tree_barrier_wait(b->tree, tid);
+            break;
+        case BARRIER_DISSEMINATION:
+            dissemination_barrier_wait(b->dissem, tid);
+            break;
+    }
+}
+
+void stage_barrier_destroy(StageBarrier* b) {
+    switch (b->kind) {
+        case BARRIER_NATIVE:
+#ifndef __APPLE__
+            pthread_barrier_destroy(&b->native);
+#endif
+            break;
+        case BARRIER_CONDVAR:
+            cond_barrier_destroy(&b->cond);
+            break;
+        default:
+            break;
+    }
+    delete b->sense;
+    delete b->tree;
+    delete b->dissem;
 }
 
 inline double now_s() {
@@ -73,34 +421,60 @@ const int TICKS = 100;
 const int BUFFER_SIZE = 50;
 
 // Recursos compartidos
-static pthread_barrier_t barrier;
+static StageBarrier barrier;
 static pthread_once_t once_flag = PTHREAD_ONCE_INIT;
 static FILE* log_file = nullptr;
 static double start_time;
 
+const size_t CHANNEL_CAPACITY = 4096;
+
 // Buffers del pipeline
 struct PipelineData {
-    std::vector<int> raw_data;
-    std::vector<int> filtered_data;
-    std::vector<int> processed_data;
+    StageChannel<int> raw;
+    StageChannel<int> filtered;
     long final_result;
     
-    pthread_mutex_t raw_mutex;
-    pthread_mutex_t filtered_mutex;
-    pthread_mutex_t processed_mutex;
-    
-    PipelineData() : final_result(0) {
-        pthread_mutex_init(&raw_mutex, nullptr);
-        pthread_mutex_init(&filtered_mutex, nullptr);
-        pthread_mutex_init(&processed_mutex, nullptr);
+    PipelineData() : raw(CHANNEL_CAPACITY), filtered(CHANNEL_CAPACITY), final_result(0) {}
+} pipeline_data;
+
+// Ticks extra al final para que el filtro y el reductor vacien los canales:
+// asi el resultado no depende de quien llego primero en el ultimo tick
+const int DRAIN_TICKS = 2;
+
+// Trabajo sintetico por lote en cada etapa (0 en los tests 1 y 2)
+static int stage_work_us = 0;
+
+static void spin_work(int us) {
+    if (us <= 0) {
+        return;
     }
-    
-    ~PipelineData() {
-        pthread_mutex_destroy(&raw_mutex);
-        pthread_mutex_destroy(&filtered_mutex);
-        pthread_mutex_destroy(&processed_mutex);
+    double end = now_s() + us * 1e-6;
+    while (now_s() < end) {
     }
-} pipeline_data;
+}
+
+// Tiempo total y tiempo bloqueado (barrera o canal) de cada etapa, por id
+struct StageTiming {
+    double elapsed;
+    double wait;
+};
+
+static StageTiming stage_timing[5];
+
+static void timed_barrier_wait(long id) {
+    double w0 = now_s();
+    stage_barrier_wait(&barrier, id - 1);
+    stage_timing[id].wait += now_s() - w0;
+}
+
+static void print_utilization(const char* const* names, const StageTiming* timing, int n) {
+    for (int i = 0; i < n; i++) {
+        double busy = timing[i].elapsed - timing[i].wait;
+        printf("  %-10s utilization %5.1f%% (busy %.3fs, waiting %.3fs)\n", names[i],
+               timing[i].elapsed > 0 ? 100.0 * busy / timing[i].elapsed : 0.0,
+               busy, timing[i].wait);
+    }
+}
 
 static void init_shared() {
     log_file = fopen("pipeline.log", "w");
@@ -112,11 +486,14 @@ static void init_shared() {
     start_time = now_s();
 }
 
+// activity debe ser un literal: en modo asincrono se formatea despues
 static void log_stage_activity(int stage_id, int tick, const char* activity) {
     if (log_file) {
         double current_time = now_s() - start_time;
-        fprintf(log_file, "[%.3f] Stage %d, Tick %d: %s\n", current_time, stage_id, tick, activity);
-        fflush(log_file);
+        log_printf(log_file, "[%.3f] Stage %d, Tick %d: %s\n", current_time, stage_id, tick, activity);
+        if (log_mode() == LOG_SYNC) {
+            fflush(log_file);
+        }
     }
 }
 
@@ -125,31 +502,31 @@ void* stage_generator(void* p) {
     long id = (long)p;
     pthread_once(&once_flag, init_shared);
     
-    std::mt19937 gen(id);
-    std::uniform_int_distribution<> dis(1, 100);
+    // Semilla = id de la etapa: la secuencia es reproducible entre corridas
+    Philox4x32 rng;
+    philox_seed(&rng, id, 0);
     
     printf("Stage %ld (Generator) starting\n", id);
+    double start = now_s();
     
-    for (int t = 0; t < TICKS; t++) {
-        // Generar datos aleatorios
-        std::vector<int> batch;
-        for (int i = 0; i < BUFFER_SIZE; i++) {
-            batch.push_back(dis(gen));
-        }
-        
-        // Agregar al buffer de datos crudos
-        pthread_mutex_lock(&pipeline_data.raw_mutex);
-        for (int val : batch) {
-            pipeline_data.raw_data.push_back(val);
+    for (int t = 0; t < TICKS + DRAIN_TICKS; t++) {
+        if (t < TICKS) {
+            // Generar datos aleatorios
+            int batch[BUFFER_SIZE];
+            philox_fill(&rng, batch, BUFFER_SIZE, 1, 100);
+            spin_work(stage_work_us);
+            
+            // Agregar al canal de datos crudos
+            pipeline_data.raw.push_many(batch, BUFFER_SIZE);
+            
+            log_stage_activity(id, t, "Generated data batch");
         }
-        pthread_mutex_unlock(&pipeline_data.raw_mutex);
-        
-        log_stage_activity(id, t, "Generated data batch");
         
         // Punto de sincronización
-        pthread_barrier_wait(&barrier);
+        timed_barrier_wait(id);
     }
     
+    stage_timing[id].elapsed = now_s() - start;
     printf("Stage %ld (Generator) completed\n", id);
     return nullptr;
 }
@@ -160,42 +537,30 @@ void* stage_filter(void* p) {
     pthread_once(&once_flag, init_shared);
     
     printf("Stage %ld (Filter) starting\n", id);
+    double start = now_s();
     
-    for (int t = 0; t < TICKS; t++) {
-        // Procesar datos crudos
-        std::vector<int> to_process;
-        
-        pthread_mutex_lock(&pipeline_data.raw_mutex);
-        // Tomar algunos datos del buffer crudo
-        int take_count = std::min((int)pipeline_data.raw_data.size(), BUFFER_SIZE);
-        for (int i = 0; i < take_count; i++) {
-            to_process.push_back(pipeline_data.raw_data[i]);
-        }
-        pipeline_data.raw_data.erase(pipeline_data.raw_data.begin(), 
-                                   pipeline_data.raw_data.begin() + take_count);
-        pthread_mutex_unlock(&pipeline_data.raw_mutex);
-        
-        // Filtrar: mantener solo números pares > 20
-        std::vector<int> filtered;
-        for (int val : to_process) {
-            if (val % 2 == 0 && val > 20) {
-                filtered.push_back(val);
-            }
-        }
-        
-        // Agregar al buffer filtrado
-        pthread_mutex_lock(&pipeline_data.filtered_mutex);
-        for (int val : filtered) {
-            pipeline_data.filtered_data.push_back(val);
+    for (int t = 0; t < TICKS + DRAIN_TICKS; t++) {
+        // Tomar todo lo disponible en el canal crudo, por lotes
+        int to_process[BUFFER_SIZE];
+        int take_count;
+        while ((take_count = pipeline_data.raw.try_pop_many(to_process, BUFFER_SIZE)) > 0) {
+            // Filtrar: mantener solo números pares > 20 (kernel SIMD segun la CPU)
+            int filtered[BUFFER_SIZE + SIMD_OUT_SLACK];
+            long ignored_sum;
+            int kept = filter_sum()(to_process, take_count, filtered, &ignored_sum);
+            spin_work(stage_work_us);
+            
+            // Agregar al canal filtrado
+            pipeline_data.filtered.push_many(filtered, kept);
         }
-        pthread_mutex_unlock(&pipeline_data.filtered_mutex);
         
         log_stage_activity(id, t, "Filtered data");
         
         // Punto de sincronización
-        pthread_barrier_wait(&barrier);
+        timed_barrier_wait(id);
     }
     
+    stage_timing[id].elapsed = now_s() - start;
     printf("Stage %ld (Filter) completed\n", id);
     return nullptr;
 }
@@ -206,21 +571,17 @@ void* stage_reducer(void* p) {
     pthread_once(&once_flag, init_shared);
     
     printf("Stage %ld (Reducer) starting\n", id);
+    double start = now_s();
     
-    for (int t = 0; t < TICKS; t++) {
-        // Procesar datos filtrados
-        std::vector<int> to_reduce;
-        
-        pthread_mutex_lock(&pipeline_data.filtered_mutex);
-        // Tomar todos los datos filtrados disponibles
-        to_reduce = pipeline_data.filtered_data;
-        pipeline_data.filtered_data.clear();
-        pthread_mutex_unlock(&pipeline_data.filtered_mutex);
-        
-        // Reducir: calcular suma y agregar al resultado final
+    for (int t = 0; t < TICKS + DRAIN_TICKS; t++) {
+        // Tomar todos los datos filtrados disponibles, sin copiar el buffer entero
+        int to_reduce[BUFFER_SIZE];
         long local_sum = 0;
-        for (int val : to_reduce) {
-            local_sum += val;
+        size_t n;
+        while ((n = pipeline_data.filtered.try_pop_many(to_reduce, BUFFER_SIZE)) > 0) {
+            // Reducir: calcular suma y agregar al resultado final
+            local_sum += sum_ints()(to_reduce, n);
+            spin_work(stage_work_us);
         }
         
         pipeline_data.final_result += local_sum;
@@ -228,9 +589,11 @@ void* stage_reducer(void* p) {
         log_stage_activity(id, t, "Reduced data");
         
         // Punto de sincronización
-        pthread_barrier_wait(&barrier);
+        timed_barrier_wait(id);
     }
     
+    stage_timing[id].elapsed = now_s() - start;
+
     printf("Stage %ld (Reducer) completed. Final result: %ld\n", id, pipeline_data.final_result);
     return nullptr;
 }
@@ -240,16 +603,12 @@ void* stage_monitor(void* p) {
     pthread_once(&once_flag, init_shared);
     
     printf("Stage %ld (Monitor) starting\n", id);
+    double start = now_s();
     
-    for (int t = 0; t < TICKS; t++) {
+    for (int t = 0; t < TICKS + DRAIN_TICKS; t++) {
         // Monitorear salud del pipeline
-        pthread_mutex_lock(&pipeline_data.raw_mutex);
-        int raw_size = pipeline_data.raw_data.size();
-        pthread_mutex_unlock(&pipeline_data.raw_mutex);
-        
-        pthread_mutex_lock(&pipeline_data.filtered_mutex);
-        int filtered_size = pipeline_data.filtered_data.size();
-        pthread_mutex_unlock(&pipeline_data.filtered_mutex);
+        int raw_size = pipeline_data.raw.size();
+        int filtered_size = pipeline_data.filtered.size();
         
         if (t % 10 == 0) { // Imprimir cada 10 ticks
             printf("Tick %d - Raw buffer: %d, Filtered buffer: %d, Result: %ld\n",
@@ -259,18 +618,24 @@ void* stage_monitor(void* p) {
         log_stage_activity(id, t, "Monitored pipeline");
         
         // Punto de sincronización
-        pthread_barrier_wait(&barrier);
+        timed_barrier_wait(id);
     }
     
+    stage_timing[id].elapsed = now_s() - start;
+
     printf("Stage %ld (Monitor) completed\n", id);
     return nullptr;
 }
 
-void test_pipeline(int num_stages) {
-    printf("Starting %d-stage pipeline for %d ticks\n", num_stages, TICKS);
+void test_pipeline(int num_stages, BarrierKind kind) {
+    printf("Starting %d-stage pipeline for %d ticks (barrier: %s)\n",
+           num_stages, TICKS, barrier_name(kind));
     
     // Inicializar barrier para todas las etapas
-    pthread_barrier_init(&barrier, NULL, num_stages);
+    stage_barrier_init(&barrier, kind, num_stages);
+    for (StageTiming& st : stage_timing) {
+        st = {0, 0};
+    }
     
     std::vector<pthread_t> threads(num_stages);
     double start = now_s();
@@ -291,14 +656,17 @@ void test_pipeline(int num_stages) {
     }
     
     double end = now_s();
+    async_log_drain();
     
     printf("\nPipeline Results:\n");
     printf("Execution time: %.3fs\n", end - start);
     printf("Final result: %ld\n", pipeline_data.final_result);
     printf("Throughput: %.2f ticks/sec\n", TICKS / (end - start));
+    const char* names[] = {"Generator", "Filter", "Reducer", "Monitor"};
+    print_utilization(names, stage_timing + 1, num_stages);
     
     // Cleanup
-    pthread_barrier_destroy(&barrier);
+    stage_barrier_destroy(&barrier);
     
     if (log_file) {
         fprintf(log_file, "Pipeline execution completed. Final result: %ld\n", pipeline_data.final_result);
@@ -307,174 +675,1786 @@ void test_pipeline(int num_stages) {
     }
 }
 
-// Pipeline alternativo sin barriers (usando colas)
-struct QueuePipeline {
-    std::vector<int> stage1_to_stage2;
-    std::vector<int> stage2_to_stage3;
-    pthread_mutex_t queue1_mutex;
-    pthread_mutex_t queue2_mutex;
-    pthread_cond_t queue1_cond;
-    pthread_cond_t queue2_cond;
-    bool pipeline_done;
-    long result;
+// ---------------------------------------------------------------------------
+// Modo wavefront: sin barrera global. Cada arista es un canal de lotes
+// etiquetados con su tick y su capacidad es la ventana de ticks en vuelo, asi
+// la etapa k procesa el tick t mientras la etapa k-1 ya produce el t+1.
+// ---------------------------------------------------------------------------
+
+const int WAVEFRONT_WINDOW = 4;   // Ticks que un productor puede adelantarse
+
+struct TickBatch {
+    int tick;
+    int count;
+    int data[BUFFER_SIZE + SIMD_OUT_SLACK];   // Holgura para los stores de los kernels SIMD
+};
+
+struct WavefrontPipeline {
+    StageChannel<TickBatch> edge1;   // Generator -> Filter
+    StageChannel<TickBatch> edge2;   // Filter -> Reducer
+    long final_result;
+    bool out_of_order;
+    StageTiming timing[3];
+    
+    WavefrontPipeline() : edge1(WAVEFRONT_WINDOW), edge2(WAVEFRONT_WINDOW), final_result(0), out_of_order(false) {}
+} wavefront;
+
+static void wave_push(StageChannel<TickBatch>& ch, const TickBatch& b, StageTiming& timing) {
+    double w0 = now_s();
+    ch.push(b);
+    timing.wait += now_s() - w0;
+}
+
+static bool wave_pop(StageChannel<TickBatch>& ch, TickBatch* b, StageTiming& timing) {
+    double w0 = now_s();
+    bool ok = ch.pop(b);
+    timing.wait += now_s() - w0;
+    return ok;
+}
+
+void* wave_generator(void*) {
+    StageTiming& timing = wavefront.timing[0];
+    double start = now_s();
+    // Misma semilla y mismos llenados que stage_generator (id 1)
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
     
-    QueuePipeline() : pipeline_done(false), result(0) {
-        pthread_mutex_init(&queue1_mutex, nullptr);
-        pthread_mutex_init(&queue2_mutex, nullptr);
-        pthread_cond_init(&queue1_cond, nullptr);
-        pthread_cond_init(&queue2_cond, nullptr);
+    TickBatch batch;
+    for (int t = 0; t < TICKS; t++) {
+        batch.tick = t;
+        batch.count = BUFFER_SIZE;
+        philox_fill(&rng, batch.data, BUFFER_SIZE, 1, 100);
+        spin_work(stage_work_us);
+        wave_push(wavefront.edge1, batch, timing);
     }
+    wavefront.edge1.close();
+    timing.elapsed = now_s() - start;
+    return nullptr;
+}
+
+void* wave_filter(void*) {
+    StageTiming& timing = wavefront.timing[1];
+    double start = now_s();
+    TickBatch in, out;
+    int expected = 0;
     
-    ~QueuePipeline() {
-        pthread_mutex_destroy(&queue1_mutex);
-        pthread_mutex_destroy(&queue2_mutex);
-        pthread_cond_destroy(&queue1_cond);
-        pthread_cond_destroy(&queue2_cond);
+    while (wave_pop(wavefront.edge1, &in, timing)) {
+        if (in.tick != expected++) {
+            wavefront.out_of_order = true;
+        }
+        out.tick = in.tick;
+        long ignored_sum;
+        out.count = filter_sum()(in.data, in.count, out.data, &ignored_sum);
+        spin_work(stage_work_us);
+        wave_push(wavefront.edge2, out, timing);
     }
-} queue_pipeline;
+    wavefront.edge2.close();
+    timing.elapsed = now_s() - start;
+    return nullptr;
+}
 
-void* queue_producer(void* p) {
-    std::mt19937 gen(1);
-    std::uniform_int_distribution<> dis(1, 100);
+void* wave_reducer(void*) {
+    StageTiming& timing = wavefront.timing[2];
+    double start = now_s();
+    TickBatch in;
+    int expected = 0;
     
-    for (int i = 0; i < TICKS * BUFFER_SIZE; i++) {
-        int data = dis(gen);
-        
-        pthread_mutex_lock(&queue_pipeline.queue1_mutex);
-        queue_pipeline.stage1_to_stage2.push_back(data);
-        pthread_cond_signal(&queue_pipeline.queue1_cond);
-        pthread_mutex_unlock(&queue_pipeline.queue1_mutex);
-        
-        usleep(100); // Simular trabajo
+    while (wave_pop(wavefront.edge2, &in, timing)) {
+        if (in.tick != expected++) {
+            wavefront.out_of_order = true;
+        }
+        long local_sum = sum_ints()(in.data, in.count);
+        spin_work(stage_work_us);
+        wavefront.final_result += local_sum;
+    }
+    timing.elapsed = now_s() - start;
+    return nullptr;
+}
+
+// Corre el wavefront sin imprimir; devuelve el tiempo y deja el resultado en
+// wavefront.final_result
+double run_wavefront() {
+    wavefront.edge1.reset();
+    wavefront.edge2.reset();
+    wavefront.final_result = 0;
+    wavefront.out_of_order = false;
+    for (StageTiming& st : wavefront.timing) {
+        st = {0, 0};
+    }
+    
+    pthread_t threads[3];
+    double start = now_s();
+    pthread_create(&threads[0], nullptr, wave_generator, nullptr);
+    pthread_create(&threads[1], nullptr, wave_filter, nullptr);
+    pthread_create(&threads[2], nullptr, wave_reducer, nullptr);
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
     }
+    return now_s() - start;
+}
+
+long test_wavefront() {
+    printf("\n=== Wavefront Pipeline (window: %d ticks) ===\n", WAVEFRONT_WINDOW);
     
-    pthread_mutex_lock(&queue_pipeline.queue1_mutex);
-    queue_pipeline.pipeline_done = true;
-    pthread_cond_broadcast(&queue_pipeline.queue1_cond);
-    pthread_mutex_unlock(&queue_pipeline.queue1_mutex);
+    double elapsed = run_wavefront();
     
-    printf("Queue Producer completed\n");
-    return nullptr;
+    printf("Execution time: %.3fs\n", elapsed);
+    printf("Final result: %ld%s\n", wavefront.final_result,
+           wavefront.out_of_order ? " (ticks out of order!)" : "");
+    printf("Throughput: %.2f ticks/sec\n", TICKS / elapsed);
+    const char* names[] = {"Generator", "Filter", "Reducer"};
+    print_utilization(names, wavefront.timing, 3);
+    return wavefront.final_result;
 }
 
-void* queue_filter(void* p) {
-    while (true) {
-        pthread_mutex_lock(&queue_pipeline.queue1_mutex);
-        while (queue_pipeline.stage1_to_stage2.empty() && !queue_pipeline.pipeline_done) {
-            pthread_cond_wait(&queue_pipeline.queue1_cond, &queue_pipeline.queue1_mutex);
-        }
-        
-        if (queue_pipeline.stage1_to_stage2.empty() && queue_pipeline.pipeline_done) {
-            pthread_mutex_unlock(&queue_pipeline.queue1_mutex);
-            break;
-        }
-        
-        int data = queue_pipeline.stage1_to_stage2.front();
-        queue_pipeline.stage1_to_stage2.erase(queue_pipeline.stage1_to_stage2.begin());
-        pthread_mutex_unlock(&queue_pipeline.queue1_mutex);
-        
-        // Filtrar
-        if (data % 2 == 0 && data > 20) {
-            pthread_mutex_lock(&queue_pipeline.queue2_mutex);
-            queue_pipeline.stage2_to_stage3.push_back(data);
-            pthread_cond_signal(&queue_pipeline.queue2_cond);
-            pthread_mutex_unlock(&queue_pipeline.queue2_mutex);
+// Barrera contra wavefront con el mismo trabajo sintetico por etapa
+void test_wavefront_compare(int work_us, BarrierKind kind) {
+    stage_work_us = work_us;
+    printf("\n=== Barrier vs Wavefront (work per stage batch: %d us) ===\n", work_us);
+    
+    pipeline_data.raw.reset();
+    pipeline_data.filtered.reset();
+    pipeline_data.final_result = 0;
+    test_pipeline(3, kind);
+    long barrier_result = pipeline_data.final_result;
+    
+    long wave_result = test_wavefront();
+    printf("\nBarrier result %ld, wavefront result %ld: %s\n", barrier_result, wave_result,
+           barrier_result == wave_result ? "MATCH" : "MISMATCH");
+    stage_work_us = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Etapas replicadas: K workers por etapa, particion por numero de lote
+// ---------------------------------------------------------------------------
+//
+// El lote seq lo genera el worker seq % Kg, lo filtra el seq % Kf y lo reduce
+// el seq % Kr. Cada lote usa su seq como stream Philox, asi que los datos no
+// dependen de cuantos workers haya. Los reductores mandan sumas parciales por
+// lote a un merge que las reordena por seq antes de combinarlas.
+
+const int REPLICA_MAX = 16;
+const size_t REPLICA_CHANNEL = 8;   // Lotes en vuelo por canal
+
+struct SeqBatch {
+    long seq;
+    int count;
+    int data[BUFFER_SIZE + SIMD_OUT_SLACK];   // Holgura para los stores de los kernels SIMD
+};
+
+struct SeqSum {
+    long seq;
+    long sum;
+};
+
+struct ReplicaConfig {
+    int generators;
+    int filters;
+    int reducers;
+    long batches;
+    int work_us;
+};
+
+struct ReplicatedPipeline {
+    ReplicaConfig cfg;
+    std::vector<StageChannel<SeqBatch>*> to_filter;   // Uno por worker de filtro
+    std::vector<StageChannel<SeqBatch>*> to_reduce;   // Uno por worker reductor
+    StageChannel<SeqSum>* to_merge;
+    std::atomic<int> generators_alive;
+    std::atomic<int> filters_alive;
+    std::atomic<int> reducers_alive;
+};
+
+struct ReplicaArgs {
+    ReplicatedPipeline* pl;
+    int worker;
+};
+
+const uint64_t REPLICA_SEED = 0x5EED;
+
+// El ultimo worker de una etapa cierra los canales de la siguiente
+static void close_if_last(std::atomic<int>& alive, std::vector<StageChannel<SeqBatch>*>& next) {
+    if (alive.fetch_sub(1) == 1) {
+        for (StageChannel<SeqBatch>* ch : next) {
+            ch->close();
         }
-        
-        usleep(50); // Simular trabajo
     }
+}
+
+void* replica_generator(void* p) {
+    ReplicaArgs* args = static_cast<ReplicaArgs*>(p);
+    ReplicatedPipeline* pl = args->pl;
+    SeqBatch batch;
     
-    pthread_mutex_lock(&queue_pipeline.queue2_mutex);
-    queue_pipeline.pipeline_done = true;
-    pthread_cond_broadcast(&queue_pipeline.queue2_cond);
-    pthread_mutex_unlock(&queue_pipeline.queue2_mutex);
-    
-    printf("Queue Filter completed\n");
+    for (long seq = args->worker; seq < pl->cfg.batches; seq += pl->cfg.generators) {
+        // Un stream Philox por lote: sembrar cuesta lo mismo que no sembrar
+        Philox4x32 rng;
+        philox_seed(&rng, REPLICA_SEED, seq);
+        batch.seq = seq;
+        batch.count = BUFFER_SIZE;
+        philox_fill(&rng, batch.data, BUFFER_SIZE, 1, 100);
+        spin_work(pl->cfg.work_us);
+        pl->to_filter[seq % pl->cfg.filters]->push(batch);
+    }
+    close_if_last(pl->generators_alive, pl->to_filter);
     return nullptr;
 }
 
-void* queue_consumer(void* p) {
-    while (true) {
-        pthread_mutex_lock(&queue_pipeline.queue2_mutex);
-        while (queue_pipeline.stage2_to_stage3.empty() && !queue_pipeline.pipeline_done) {
-            pthread_cond_wait(&queue_pipeline.queue2_cond, &queue_pipeline.queue2_mutex);
-        }
-        
-        if (queue_pipeline.stage2_to_stage3.empty() && queue_pipeline.pipeline_done) {
-            pthread_mutex_unlock(&queue_pipeline.queue2_mutex);
-            break;
-        }
-        
-        int data = queue_pipeline.stage2_to_stage3.front();
-        queue_pipeline.stage2_to_stage3.erase(queue_pipeline.stage2_to_stage3.begin());
-        pthread_mutex_unlock(&queue_pipeline.queue2_mutex);
-        
-        queue_pipeline.result += data;
-        usleep(25); // Simular trabajo
+void* replica_filter(void* p) {
+    ReplicaArgs* args = static_cast<ReplicaArgs*>(p);
+    ReplicatedPipeline* pl = args->pl;
+    SeqBatch in, out;
+    
+    while (pl->to_filter[args->worker]->pop(&in)) {
+        out.seq = in.seq;
+        long ignored_sum;
+        out.count = filter_sum()(in.data, in.count, out.data, &ignored_sum);
+        spin_work(pl->cfg.work_us);
+        pl->to_reduce[out.seq % pl->cfg.reducers]->push(out);
     }
+    close_if_last(pl->filters_alive, pl->to_reduce);
+    return nullptr;
+}
+
+void* replica_reducer(void* p) {
+    ReplicaArgs* args = static_cast<ReplicaArgs*>(p);
+    ReplicatedPipeline* pl = args->pl;
+    SeqBatch in;
     
-    printf("Queue Consumer completed. Result: %ld\n", queue_pipeline.result);
+    while (pl->to_reduce[args->worker]->pop(&in)) {
+        SeqSum partial = {in.seq, sum_ints()(in.data, in.count)};
+        spin_work(pl->cfg.work_us);
+        pl->to_merge->push(partial);
+    }
+    if (pl->reducers_alive.fetch_sub(1) == 1) {
+        pl->to_merge->close();
+    }
     return nullptr;
 }
 
-void test_queue_pipeline() {
-    printf("\n=== Queue-based Pipeline ===\n");
+struct ReplicaResult {
+    long final_result;
+    uint64_t order_hash;   // Depende del orden de combinacion: prueba que el merge es ordenado
+    double seconds;
+    long max_reorder;      // Lotes retenidos a la vez esperando a uno anterior
+};
+
+ReplicaResult run_replicated(const ReplicaConfig& cfg) {
+    ReplicatedPipeline pl;
+    pl.cfg = cfg;
+    for (int i = 0; i < cfg.filters; i++) {
+        pl.to_filter.push_back(new StageChannel<SeqBatch>(REPLICA_CHANNEL));
+    }
+    for (int i = 0; i < cfg.reducers; i++) {
+        pl.to_reduce.push_back(new StageChannel<SeqBatch>(REPLICA_CHANNEL));
+    }
+    pl.to_merge = new StageChannel<SeqSum>(REPLICA_CHANNEL * cfg.reducers);
+    pl.generators_alive = cfg.generators;
+    pl.filters_alive = cfg.filters;
+    pl.reducers_alive = cfg.reducers;
     
-    pthread_t producer, filter, consumer;
-    double start = now_s();
+    int nthreads = cfg.generators + cfg.filters + cfg.reducers;
+    std::vector<pthread_t> threads(nthreads);
+    std::vector<ReplicaArgs> args(nthreads);
     
-    pthread_create(&producer, nullptr, queue_producer, nullptr);
-    pthread_create(&filter, nullptr, queue_filter, nullptr);
-    pthread_create(&consumer, nullptr, queue_consumer, nullptr);
+    double start = now_s();
+    int t = 0;
+    for (int i = 0; i < cfg.generators; i++, t++) {
+        args[t] = {&pl, i};
+        pthread_create(&threads[t], nullptr, replica_generator, &args[t]);
+    }
+    for (int i = 0; i < cfg.filters; i++, t++) {
+        args[t] = {&pl, i};
+        pthread_create(&threads[t], nullptr, replica_filter, &args[t]);
+    }
+    for (int i = 0; i < cfg.reducers; i++, t++) {
+        args[t] = {&pl, i};
+        pthread_create(&threads[t], nullptr, replica_reducer, &args[t]);
+    }
     
-    pthread_join(producer, nullptr);
-    pthread_join(filter, nullptr);
-    pthread_join(consumer, nullptr);
+    // Merge ordenado en este thread: las sumas llegan en cualquier orden y se
+    // combinan en orden de seq
+    ReplicaResult res = {0, 1469598103934665603ull, 0, 0};
+    std::vector<long> sums(cfg.batches);
+    std::vector<char> ready(cfg.batches, 0);
+    long next = 0, held = 0;
+    SeqSum part;
+    while (pl.to_merge->pop(&part)) {
+        sums[part.seq] = part.sum;
+        ready[part.seq] = 1;
+        held++;
+        res.max_reorder = std::max(res.max_reorder, held - 1);
+        while (next < cfg.batches && ready[next]) {
+            res.final_result += sums[next];
+            res.order_hash = (res.order_hash ^ (uint64_t)sums[next]) * 1099511628211ull;
+            next++;
+            held--;
+        }
+    }
     
-    double end = now_s();
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
+    }
+    res.seconds = now_s() - start;
     
-    printf("Queue Pipeline Results:\n");
-    printf("Execution time: %.3fs\n", end - start);
-    printf("Final result: %ld\n", queue_pipeline.result);
-    printf("Throughput: %.2f items/sec\n", (TICKS * BUFFER_SIZE) / (end - start));
+    for (StageChannel<SeqBatch>* ch : pl.to_filter) {
+        delete ch;
+    }
+    for (StageChannel<SeqBatch>* ch : pl.to_reduce) {
+        delete ch;
+    }
+    delete pl.to_merge;
+    return res;
+}
+
+void test_replicated(int argc, char** argv) {
+    ReplicaConfig cfg;
+    cfg.batches = (argc > 5) ? std::atol(argv[5]) : 20000;
+    cfg.work_us = (argc > 6) ? std::atoi(argv[6]) : 0;
+    
+    // Sin argumentos se barre K = 1, 2, 4, 8 en todas las etapas
+    std::vector<ReplicaConfig> runs;
+    if (argc > 2) {
+        cfg.generators = std::atoi(argv[2]);
+        cfg.filters = (argc > 3) ? std::atoi(argv[3]) : cfg.generators;
+        cfg.reducers = (argc > 4) ? std::atoi(argv[4]) : cfg.filters;
+        if (cfg.generators < 1 || cfg.filters < 1 || cfg.reducers < 1 ||
+            cfg.generators > REPLICA_MAX || cfg.filters > REPLICA_MAX || cfg.reducers > REPLICA_MAX) {
+            printf("Workers per stage must be between 1 and %d\n", REPLICA_MAX);
+            return;
+        }
+        ReplicaConfig base = cfg;
+        base.generators = base.filters = base.reducers = 1;
+        runs.push_back(base);
+        runs.push_back(cfg);
+    } else {
+        for (int k = 1; k <= 8; k *= 2) {
+            cfg.generators = cfg.filters = cfg.reducers = k;
+            runs.push_back(cfg);
+        }
+    }
+    
+    printf("\n=== Replicated Stages (batches: %ld, work per batch: %d us, cores: %ld) ===\n",
+           cfg.batches, cfg.work_us, sysconf(_SC_NPROCESSORS_ONLN));
+    ReplicaResult base = {0, 0, 0, 0};
+    for (size_t i = 0; i < runs.size(); i++) {
+        const ReplicaConfig& rc = runs[i];
+        ReplicaResult res = run_replicated(rc);
+        if (i == 0) {
+            base = res;
+        }
+        double items = (double)rc.batches * BUFFER_SIZE;
+        printf("G%-2d F%-2d R%-2d threads=%-3d %.3fs, %.0f items/sec (x%.2f), result %ld, "
+               "max reorder %ld %s\n",
+               rc.generators, rc.filters, rc.reducers, rc.generators + rc.filters + rc.reducers + 1,
+               res.seconds, items / res.seconds, base.seconds / res.seconds, res.final_result,
+               res.max_reorder,
+               res.final_result == base.final_result && res.order_hash == base.order_hash
+                   ? "[MATCH]" : "[MISMATCH]");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pool de lotes reciclados: los canales llevan punteros a buffers de un slab
+// reservado antes de arrancar. Cada etapa es dueña del lote que sacó y lo pasa
+// a la siguiente; el filtro compacta en el mismo buffer y el reductor lo
+// devuelve al generador por una lista libre SPSC sin lock. Si la lista se
+// vacia el generador espera (contrapresion).
+// ---------------------------------------------------------------------------
+
+const size_t POOL_EDGE = 8;                           // Lotes en vuelo por arista
+const int POOL_BATCHES = 2 * (int)POOL_EDGE + 3;      // Aristas llenas + uno por etapa
+const size_t POOL_RING = 32;                          // Potencia de 2 >= POOL_BATCHES
+
+// Una linea de cache propia por lote: dos etapas nunca comparten linea
+struct alignas(64) PoolBatch {
+    long seq;
+    int count;
+    int data[BUFFER_SIZE + SIMD_OUT_SLACK];   // Holgura para los stores de los kernels SIMD
+};
+
+struct BatchPool {
+    PoolBatch* slab;
+    PoolBatch* ring[POOL_RING];
+    alignas(64) std::atomic<size_t> head;   // Solo lo avanza el generador
+    alignas(64) std::atomic<size_t> tail;   // Solo lo avanza el reductor
+
+    BatchPool() : slab(new PoolBatch[POOL_BATCHES]), head(0), tail(POOL_BATCHES) {
+        for (int i = 0; i < POOL_BATCHES; i++) {
+            ring[i] = &slab[i];
+        }
+    }
+
+    ~BatchPool() {
+        delete[] slab;
+    }
+
+    PoolBatch* acquire() {
+        size_t h = head.load(std::memory_order_relaxed);
+        spin_until([&] { return tail.load(std::memory_order_acquire) != h; });
+        PoolBatch* b = ring[h % POOL_RING];
+        head.store(h + 1, std::memory_order_release);
+        return b;
+    }
+
+    // Nunca hay mas de POOL_BATCHES lotes fuera: el ring no se desborda
+    void release(PoolBatch* b) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        ring[t % POOL_RING] = b;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    size_t available() {
+        return tail.load() - head.load();
+    }
+};
+
+// pooled = false reproduce el patron anterior: buffer nuevo por lote en el
+// generador y otro para la salida del filtro, cada uno liberado por quien lo
+// consume
+struct PoolPipeline {
+    bool pooled;
+    long batches;
+    BatchPool* pool;
+    StageChannel<PoolBatch*> edge1;   // Generator -> Filter
+    StageChannel<PoolBatch*> edge2;   // Filter -> Reducer
+    long final_result;
+
+    PoolPipeline() : pooled(false), batches(0), pool(nullptr), edge1(POOL_EDGE), edge2(POOL_EDGE), final_result(0) {}
+};
+
+
+void* pool_generator(void* p) {
+    PoolPipeline* pl = static_cast<PoolPipeline*>(p);
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+
+    for (long seq = 0; seq < pl->batches; seq++) {
+        PoolBatch* b = pl->pooled ? pl->pool->acquire() : new PoolBatch;
+        b->seq = seq;
+        b->count = BUFFER_SIZE;
+        philox_fill(&rng, b->data, BUFFER_SIZE, 1, 100);
+        pl->edge1.push(b);
+    }
+    pl->edge1.close();
+    return nullptr;
+}
+
+void* pool_filter(void* p) {
+    PoolPipeline* pl = static_cast<PoolPipeline*>(p);
+    PoolBatch* in;
+
+    while (pl->edge1.pop(&in)) {
+        long ignored_sum;
+        if (pl->pooled) {
+            // Compactar sobre el mismo buffer y pasarlo tal cual
+            in->count = filter_sum()(in->data, in->count, in->data, &ignored_sum);
+            pl->edge2.push(in);
+        } else {
+            PoolBatch* out = new PoolBatch;
+            out->seq = in->seq;
+            out->count = filter_sum()(in->data, in->count, out->data, &ignored_sum);
+            delete in;
+            pl->edge2.push(out);
+        }
+    }
+    pl->edge2.close();
+    return nullptr;
+}
+
+void* pool_reducer(void* p) {
+    PoolPipeline* pl = static_cast<PoolPipeline*>(p);
+    PoolBatch* in;
+
+    while (pl->edge2.pop(&in)) {
+        pl->final_result += sum_ints()(in->data, in->count);
+        if (pl->pooled) {
+            pl->pool->release(in);
+        } else {
+            delete in;
+        }
+    }
+    return nullptr;
+}
+
+struct PoolRunResult {
+    double seconds;
+    long allocs;    // Reservas mientras corren las etapas (sin contar el setup)
+    long result;
+};
+
+PoolRunResult run_pool_pipeline(bool pooled, long batches) {
+    PoolPipeline pl;
+    pl.pooled = pooled;
+    pl.batches = batches;
+    if (pooled) {
+        pl.pool = new BatchPool();
+    }
+
+    pthread_t threads[3];
+    long allocs0 = heap_allocs.load();
+    double start = now_s();
+    pthread_create(&threads[0], nullptr, pool_generator, &pl);
+    pthread_create(&threads[1], nullptr, pool_filter, &pl);
+    pthread_create(&threads[2], nullptr, pool_reducer, &pl);
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
+    }
+    PoolRunResult res = {now_s() - start, heap_allocs.load() - allocs0, pl.final_result};
+
+    if (pooled) {
+        if ((int)pl.pool->available() != POOL_BATCHES) {
+            printf("Pool leak: %zu of %d batches returned\n", pl.pool->available(), POOL_BATCHES);
+        }
+        delete pl.pool;
+    }
+    return res;
+}
+
+void test_batch_pool(long batches) {
+    printf("\n=== Batch Buffer Pool (batches: %ld, pool: %d x %zu bytes) ===\n",
+           batches, POOL_BATCHES, sizeof(PoolBatch));
+
+    // Calentar los kernels y el logger fuera de la medicion
+    run_pool_pipeline(true, 100);
+
+    PoolRunResult heap = run_pool_pipeline(false, batches);
+    PoolRunResult pool = run_pool_pipeline(true, batches);
+    double items = (double)batches * BUFFER_SIZE;
+
+    printf("%-12s %10s %14s %12s %16s\n", "mode", "time", "items/sec", "allocs", "allocs/batch");
+    printf("%-12s %9.3fs %14.0f %12ld %16.2f\n", "new/delete", heap.seconds, items / heap.seconds,
+           heap.allocs, (double)heap.allocs / batches);
+    printf("%-12s %9.3fs %14.0f %12ld %16.2f\n", "pool", pool.seconds, items / pool.seconds,
+           pool.allocs, (double)pool.allocs / batches);
+    printf("Throughput gain: x%.2f, results %s, steady state %s\n", heap.seconds / pool.seconds,
+           heap.result == pool.result ? "[MATCH]" : "[MISMATCH]",
+           pool.allocs == 0 ? "[ZERO ALLOCS]" : "[ALLOCATES]");
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline de colas escrito a mano
+// ---------------------------------------------------------------------------
+
+// Pipeline alternativo sin barriers (usando colas). Cada arista es un
+// StageChannel cuya capacidad son los creditos: el productor gasta uno por
+// elemento y el consumidor lo devuelve al sacarlo, asi la memoria en vuelo
+// por arista nunca pasa de credits enteros. Los elementos viajan en chunks
+// de hasta chunk por cada toma del lock.
+struct QueueConfig {
+    size_t chunk;       // Elementos por push/pop
+    size_t credits;     // Capacidad de cada arista
+    long items;
+    int work_us;        // usleep por elemento: productor work, filtro /2, consumidor /4
+    bool verbose;
+};
+
+const QueueConfig QUEUE_DEFAULT = {1, CHANNEL_CAPACITY, TICKS * BUFFER_SIZE, 100, true};
+
+struct QueuePipeline {
+    QueueConfig cfg;
+    StageChannel<int> stage1_to_stage2;
+    StageChannel<int> stage2_to_stage3;
+    long result;
+    
+    explicit QueuePipeline(const QueueConfig& c)
+        : cfg(c), stage1_to_stage2(c.credits), stage2_to_stage3(c.credits), result(0) {}
+};
+
+// El trabajo simulado es por elemento: un chunk duerme por todos los suyos
+static void queue_work(int us, size_t n) {
+    if (us > 0 && n > 0) {
+        usleep(us * n);
+    }
+}
+
+void* queue_producer(void* p) {
+    QueuePipeline* qp = static_cast<QueuePipeline*>(p);
+    const QueueConfig& cfg = qp->cfg;
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    int batch[BUFFER_SIZE];
+    std::vector<int> chunk(cfg.chunk);
+    size_t n = 0;
+    
+    // Los datos salen en lotes de BUFFER_SIZE sin importar el chunk, asi el
+    // resultado es el mismo para cualquier configuracion
+    for (long i = 0; i < cfg.items; i++) {
+        if (i % BUFFER_SIZE == 0) {
+            philox_fill(&rng, batch, BUFFER_SIZE, 1, 100);
+        }
+        chunk[n++] = batch[i % BUFFER_SIZE];
+        if (n == cfg.chunk || i + 1 == cfg.items) {
+            queue_work(cfg.work_us, n);
+            qp->stage1_to_stage2.push_many(chunk.data(), n);
+            n = 0;
+        }
+    }
+    
+    qp->stage1_to_stage2.close();
+    if (cfg.verbose) {
+        printf("Queue Producer completed\n");
+    }
+    return nullptr;
+}
+
+void* queue_filter(void* p) {
+    QueuePipeline* qp = static_cast<QueuePipeline*>(p);
+    const QueueConfig& cfg = qp->cfg;
+    std::vector<int> in(cfg.chunk), out(cfg.chunk);
+    size_t n;
+    while ((n = qp->stage1_to_stage2.pop_many(in.data(), cfg.chunk)) > 0) {
+        // Filtrar
+        size_t kept = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (in[i] % 2 == 0 && in[i] > 20) {
+                out[kept++] = in[i];
+            }
+        }
+        queue_work(cfg.work_us / 2, n);
+        qp->stage2_to_stage3.push_many(out.data(), kept);
+    }
+    
+    qp->stage2_to_stage3.close();
+    if (cfg.verbose) {
+        printf("Queue Filter completed\n");
+    }
+    return nullptr;
+}
+
+void* queue_consumer(void* p) {
+    QueuePipeline* qp = static_cast<QueuePipeline*>(p);
+    const QueueConfig& cfg = qp->cfg;
+    std::vector<int> in(cfg.chunk);
+    size_t n;
+    while ((n = qp->stage2_to_stage3.pop_many(in.data(), cfg.chunk)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            qp->result += in[i];
+        }
+        queue_work(cfg.work_us / 4, n);
+    }
+    
+    if (cfg.verbose) {
+        printf("Queue Consumer completed. Result: %ld\n", qp->result);
+    }
+    return nullptr;
+}
+
+struct QueueResult {
+    double seconds;
+    long result;
+    size_t peak1, peak2;    // Maxima ocupacion de cada arista
+    long max_rss_kb;        // Solo en el barrido (proceso hijo)
+};
+
+QueueResult run_queue_pipeline(const QueueConfig& cfg) {
+    QueuePipeline qp(cfg);
+    pthread_t producer, filter, consumer;
+    double start = now_s();
+    
+    pthread_create(&producer, nullptr, queue_producer, &qp);
+    pthread_create(&filter, nullptr, queue_filter, &qp);
+    pthread_create(&consumer, nullptr, queue_consumer, &qp);
+    
+    pthread_join(producer, nullptr);
+    pthread_join(filter, nullptr);
+    pthread_join(consumer, nullptr);
+    
+    QueueResult res = {now_s() - start, qp.result, qp.stage1_to_stage2.peak, qp.stage2_to_stage3.peak, 0};
+    return res;
+}
+
+void test_queue_pipeline(const QueueConfig& cfg) {
+    printf("\n=== Queue-based Pipeline (chunk %zu, credits %zu per edge, work %d us) ===\n",
+           cfg.chunk, cfg.credits, cfg.work_us);
+    
+    QueueResult res = run_queue_pipeline(cfg);
+    
+    printf("Queue Pipeline Results:\n");
+    printf("Execution time: %.3fs\n", res.seconds);
+    printf("Final result: %ld\n", res.result);
+    printf("Throughput: %.2f items/sec\n", cfg.items / res.seconds);
+    printf("Peak in flight: %zu / %zu items per edge\n", res.peak1, res.peak2);
+}
+
+// Una corrida del barrido en un proceso hijo; bajo TSan en este mismo proceso
+bool run_queue_child(const QueueConfig& cfg, QueueResult* out) {
+#ifdef P5_UNDER_TSAN
+    *out = run_queue_pipeline(cfg);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    out->max_rss_kb = ru.ru_maxrss;
+    return true;
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        QueueResult res = run_queue_pipeline(cfg);
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        res.max_rss_kb = ru.ru_maxrss;
+        ssize_t w = write(fds[1], &res, sizeof(res));
+        _exit(w == (ssize_t)sizeof(res) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = pid > 0 && read(fds[0], out, sizeof(*out)) == (ssize_t)sizeof(*out);
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+    }
+    return ok;
+#endif
+}
+
+// Barrido de chunk x creditos sin trabajo simulado. Cada corrida va en un
+// proceso hijo: ru_maxrss del hijo solo cuenta las paginas que toca el, asi
+// el pico de memoria de una configuracion no arrastra el de la anterior.
+void test_queue_flow_sweep(long items) {
+    const size_t chunks[] = {1, 16, 256};
+    const size_t credits[] = {256, 4096, 65536, 1 << 20};
+    
+    printf("\n=== Queue Pipeline Chunk x Credits Sweep (items: %ld, no simulated work) ===\n", items);
+#ifdef P5_UNDER_TSAN
+    printf("TSan build: runs in this process, not in forked children; max RSS is cumulative\n");
+#endif
+    printf("%-6s %-8s %14s %12s %12s %12s %10s\n",
+           "chunk", "credits", "items/sec", "peak edge1", "peak edge2", "max RSS KB", "result");
+    fflush(stdout);
+    
+    long expected = -1;
+    for (size_t chunk : chunks) {
+        for (size_t credit : credits) {
+            QueueConfig cfg = {chunk, credit, items, 0, false};
+            QueueResult res;
+            if (!run_queue_child(cfg, &res)) {
+                printf("%-6zu %-8zu run failed\n", chunk, credit);
+                continue;
+            }
+            if (expected < 0) {
+                expected = res.result;
+            }
+            printf("%-6zu %-8zu %14.0f %12zu %12zu %12ld %10ld%s\n", chunk, credit,
+                   items / res.seconds, res.peak1, res.peak2, res.max_rss_kb, res.result,
+                   res.result == expected ? "" : " [MISMATCH]");
+            fflush(stdout);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pipelines armados con stage_pipeline.hpp
+// ---------------------------------------------------------------------------
+
+// Pipeline de colas: enteros sueltos, filtro partido en dos predicados y un
+// map int -> long antes del sumidero. items = TICKS * BUFFER_SIZE da el mismo
+// resultado que el test 3.
+template <FusionMode Mode>
+double run_framework_queue(long items, int filter_threads, long* result, bool print_stages) {
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    int batch[BUFFER_SIZE];
+    long produced = 0;
+    long total = 0;
+    
+    auto source = make_source<int>([&](int* buf, size_t max) {
+        size_t n = 0;
+        while (n < max && produced < items) {
+            if (produced % BUFFER_SIZE == 0) {
+                philox_fill(&rng, batch, BUFFER_SIZE, 1, 100);
+            }
+            buf[n++] = batch[produced++ % BUFFER_SIZE];
+        }
+        return n;
+    });
+    auto even = filter_stage<int>("even", [](int v) { return v % 2 == 0; }, filter_threads);
+    auto above = filter_stage<int>("gt20", [](int v) { return v > 20; }, filter_threads);
+    auto widen = map_stage<int, long>("widen", [](int v, long& out) { out = v; return true; }, filter_threads);
+    auto sink = make_sink<long>([&](const long* buf, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            total += buf[i];
+        }
+    });
+    
+    auto pl = make_pipeline<Mode>(source, sink, even, above, widen);
+    if (print_stages) {
+        printf("  stages:");
+        pl.for_each_stage([](const char* name, int threads) { printf(" [%s x%d]", name, threads); });
+        printf(" -> %d threads\n", pl.thread_count());
+    }
+    double start = now_s();
+    pl.run();
+    *result = total;
+    return now_s() - start;
+}
+
+// Pipeline de lotes (como el wavefront): el filtro SIMD y la suma por lote
+template <FusionMode Mode>
+double run_framework_batches(long batches, long* result) {
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    long produced = 0;
+    long total = 0;
+    
+    auto source = make_source<TickBatch>([&](TickBatch* buf, size_t max) {
+        size_t n = 0;
+        for (; n < max && produced < batches; n++, produced++) {
+            buf[n].tick = (int)produced;
+            buf[n].count = BUFFER_SIZE;
+            philox_fill(&rng, buf[n].data, BUFFER_SIZE, 1, 100);
+        }
+        return n;
+    });
+    auto filter = map_stage<TickBatch, TickBatch>("filter", [](const TickBatch& in, TickBatch& out) {
+        long ignored_sum;
+        out.tick = in.tick;
+        out.count = filter_sum()(in.data, in.count, out.data, &ignored_sum);
+        return out.count > 0;
+    });
+    auto reduce = map_stage<TickBatch, long>("reduce", [](const TickBatch& in, long& out) {
+        out = sum_ints()(in.data, in.count);
+        return true;
+    });
+    auto sink = make_sink<long>([&](const long* buf, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            total += buf[i];
+        }
+    });
+    
+    auto pl = make_pipeline<Mode>(source, sink, filter, reduce);
+    double start = now_s();
+    pl.run();
+    *result = total;
+    return now_s() - start;
+}
+
+void test_stage_framework(long items, int filter_threads) {
+    printf("\n=== Typed Stage Framework: fused vs unfused (items: %ld, cores: %ld) ===\n",
+           items, sysconf(_SC_NPROCESSORS_ONLN));
+    
+    // Mismo dato que los pipelines escritos a mano: se corren ambos en vivo
+    long check_queue, check_batches;
+    run_framework_queue<FUSE_STATELESS>(TICKS * BUFFER_SIZE, 1, &check_queue, false);
+    run_framework_batches<FUSE_STATELESS>(TICKS, &check_batches);
+    QueueConfig hand_cfg = QUEUE_DEFAULT;
+    hand_cfg.work_us = 0;
+    hand_cfg.verbose = false;
+    long hand_queue = run_queue_pipeline(hand_cfg).result;
+    run_wavefront();
+    long hand_batches = wavefront.final_result;
+    printf("Queue pipeline: framework %ld, hand-written %ld %s\n", check_queue, hand_queue,
+           check_queue == hand_queue ? "[MATCH]" : "[MISMATCH]");
+    printf("Batch pipeline: framework %ld, wavefront %ld %s\n", check_batches, hand_batches,
+           check_batches == hand_batches ? "[MATCH]" : "[MISMATCH]");
+    
+    long unfused_result, fused_result, wide_result;
+    printf("Unfused:\n");
+    double unfused = run_framework_queue<FUSE_NONE>(items, 1, &unfused_result, true);
+    printf("Fused:\n");
+    double fused = run_framework_queue<FUSE_STATELESS>(items, 1, &fused_result, true);
+    printf("Fused, %d filter threads:\n", filter_threads);
+    double wide = run_framework_queue<FUSE_STATELESS>(items, filter_threads, &wide_result, true);
+    
+    printf("%-22s %10s %14s %12s\n", "mode", "time", "items/sec", "result");
+    printf("%-22s %9.3fs %14.0f %12ld\n", "unfused", unfused, items / unfused, unfused_result);
+    printf("%-22s %9.3fs %14.0f %12ld (x%.2f)\n", "fused", fused, items / fused, fused_result, unfused / fused);
+    printf("%-22s %9.3fs %14.0f %12ld (x%.2f)\n", "fused, wide filter", wide, items / wide, wide_result,
+           unfused / wide);
+    
+    long batch_unfused_result, batch_fused_result;
+    long batches = items / BUFFER_SIZE;
+    double batch_unfused = run_framework_batches<FUSE_NONE>(batches, &batch_unfused_result);
+    double batch_fused = run_framework_batches<FUSE_STATELESS>(batches, &batch_fused_result);
+    printf("Batches (%ld): unfused %.3fs, fused %.3fs (x%.2f), results %s\n", batches,
+           batch_unfused, batch_fused, batch_unfused / batch_fused,
+           batch_unfused_result == batch_fused_result ? "[MATCH]" : "[MISMATCH]");
+    printf("Fused results %s\n",
+           unfused_result == fused_result && fused_result == wide_result ? "[MATCH]" : "[MISMATCH]");
+}
+
+// ---------------------------------------------------------------------------
+// Etapas con costo desbalanceado: barrera, thread por etapa y work stealing
+// ---------------------------------------------------------------------------
+//
+// Los tres modos ejecutan las mismas funciones por (lote, etapa) sobre una
+// ventana de SkewConfig::window lotes en vuelo; el lote seq usa el slot
+// seq % window y su stream Philox es seq, asi los tres dan el mismo resultado.
+// La latencia de un lote va del inicio de su generacion al fin de su reduccion.
+
+const int SKEW_STAGES = 3;
+
+struct SkewConfig {
+    long batches;
+    int window;
+    int stage_us[SKEW_STAGES];
+    int workers;
+};
+
+struct alignas(64) SkewSlot {
+    int count;
+    int data[BUFFER_SIZE + SIMD_OUT_SLACK];   // Holgura para los stores de los kernels SIMD
+};
+
+struct SkewPipeline {
+    SkewConfig cfg;
+    std::vector<SkewSlot> slots;
+    std::vector<long> sums;
+    std::vector<double> start;
+    std::vector<double> latency;
+    std::atomic<long> completed;
+    WorkStealingPool* pool;
+    
+    explicit SkewPipeline(const SkewConfig& c)
+        : cfg(c), slots(c.window), sums(c.batches), start(c.batches), latency(c.batches), completed(0),
+          pool(nullptr) {}
+};
+
+static void skew_stage(SkewPipeline* sp, long seq, int stage) {
+    SkewSlot& slot = sp->slots[seq % sp->cfg.window];
+    long ignored_sum;
+    int cost_us = 0;
+    switch (stage) {
+        case 0: {
+            sp->start[seq] = now_s();
+            Philox4x32 rng;
+            philox_seed(&rng, REPLICA_SEED, seq);
+            slot.count = BUFFER_SIZE;
+            philox_fill(&rng, slot.data, BUFFER_SIZE, 1, 100);
+            cost_us = sp->cfg.stage_us[0];
+            break;
+        }
+        case 1:
+            slot.count = filter_sum()(slot.data, slot.count, slot.data, &ignored_sum);
+            cost_us = sp->cfg.stage_us[1];
+            break;
+        case 2:
+            sp->sums[seq] = sum_ints()(slot.data, slot.count);
+            cost_us = sp->cfg.stage_us[2];
+            break;
+    }
+    spin_work(cost_us);
+    if (stage == SKEW_STAGES - 1) {
+        sp->latency[seq] = now_s() - sp->start[seq];
+    }
+}
+
+// Tarea = seq * SKEW_STAGES + etapa. Cada tarea genera su continuacion; la
+// reduccion de seq libera el slot y genera el lote seq + window.
+static void skew_task(void* ctx, uint64_t task, int worker) {
+    SkewPipeline* sp = static_cast<SkewPipeline*>(ctx);
+    long seq = task / SKEW_STAGES;
+    int stage = task % SKEW_STAGES;
+    skew_stage(sp, seq, stage);
+    if (stage < SKEW_STAGES - 1) {
+        sp->pool->spawn(worker, task + 1);
+        return;
+    }
+    long next = seq + sp->cfg.window;
+    if (next < sp->cfg.batches) {
+        sp->pool->spawn(worker, next * SKEW_STAGES);
+    }
+    if (sp->completed.fetch_add(1) + 1 == sp->cfg.batches) {
+        sp->pool->finish();
+    }
+}
+
+void run_skew_stealing(SkewPipeline* sp, long* steals) {
+    WorkStealingPool pool(sp->cfg.workers, skew_task, sp);
+    sp->pool = &pool;
+    // Los primeros lotes de la ventana se reparten entre los deques
+    for (long seq = 0; seq < std::min<long>(sp->cfg.window, sp->cfg.batches); seq++) {
+        pool.spawn(seq % sp->cfg.workers, seq * SKEW_STAGES);
+    }
+    pool.run();
+    *steals = pool.total_steals();
+    sp->pool = nullptr;
+}
+
+// Un thread fijo por etapa; los canales llevan numeros de lote y los creditos
+// devuelven los slots libres al generador
+struct SkewPinnedArgs {
+    SkewPipeline* sp;
+    int stage;
+    StageChannel<long>* in;
+    StageChannel<long>* out;
+};
+
+void* skew_pinned_worker(void* p) {
+    SkewPinnedArgs* args = static_cast<SkewPinnedArgs*>(p);
+    SkewPipeline* sp = args->sp;
+    long seq;
+    if (args->stage == 0) {
+        for (long s = 0; s < sp->cfg.batches; s++) {
+            args->in->pop(&seq);   // Credito: un slot libre
+            skew_stage(sp, s, 0);
+            args->out->push(s);
+        }
+        args->out->close();
+        return nullptr;
+    }
+    while (args->in->pop(&seq)) {
+        skew_stage(sp, seq, args->stage);
+        args->out->push(seq);
+    }
+    if (args->stage == 1) {
+        args->out->close();
+    }
+    return nullptr;
+}
+
+void run_skew_pinned(SkewPipeline* sp) {
+    size_t window = sp->cfg.window;
+    StageChannel<long> credits(window), edge1(window), edge2(window);
+    for (size_t i = 0; i < window; i++) {
+        credits.push(0);
+    }
+    SkewPinnedArgs args[SKEW_STAGES] = {
+        {sp, 0, &credits, &edge1},
+        {sp, 1, &edge1, &edge2},
+        {sp, 2, &edge2, &credits},
+    };
+    pthread_t threads[SKEW_STAGES];
+    for (int i = 0; i < SKEW_STAGES; i++) {
+        pthread_create(&threads[i], nullptr, skew_pinned_worker, &args[i]);
+    }
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
+    }
+}
+
+// Un thread por etapa con barrera por tick: en el tick t la etapa k procesa
+// el lote t - k, asi cada tick dura lo que la etapa mas lenta
+struct SkewBarrierArgs {
+    SkewPipeline* sp;
+    StageBarrier* barrier;
+    int stage;
+};
+
+void* skew_barrier_worker(void* p) {
+    SkewBarrierArgs* args = static_cast<SkewBarrierArgs*>(p);
+    SkewPipeline* sp = args->sp;
+    for (long t = 0; t < sp->cfg.batches + SKEW_STAGES - 1; t++) {
+        long seq = t - args->stage;
+        if (seq >= 0 && seq < sp->cfg.batches) {
+            skew_stage(sp, seq, args->stage);
+        }
+        stage_barrier_wait(args->barrier, args->stage);
+    }
+    return nullptr;
+}
+
+void run_skew_barrier(SkewPipeline* sp) {
+    StageBarrier b;
+    stage_barrier_init(&b, BARRIER_NATIVE, SKEW_STAGES);
+    SkewBarrierArgs args[SKEW_STAGES];
+    pthread_t threads[SKEW_STAGES];
+    for (int i = 0; i < SKEW_STAGES; i++) {
+        args[i] = {sp, &b, i};
+        pthread_create(&threads[i], nullptr, skew_barrier_worker, &args[i]);
+    }
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
+    }
+    stage_barrier_destroy(&b);
+}
+
+enum SkewMode {
+    SKEW_BARRIER,
+    SKEW_PINNED,
+    SKEW_STEALING
+};
+
+void run_skew_mode(SkewMode mode, const SkewConfig& cfg, long* expected) {
+    SkewPipeline sp(cfg);
+    long steals = 0;
+    int threads = SKEW_STAGES;
+    const char* name = "barrier";
+    double start = now_s();
+    switch (mode) {
+        case SKEW_BARRIER:
+            run_skew_barrier(&sp);
+            break;
+        case SKEW_PINNED:
+            name = "thread-per-stage";
+            run_skew_pinned(&sp);
+            break;
+        case SKEW_STEALING:
+            name = "work-stealing";
+            threads = cfg.workers;
+            run_skew_stealing(&sp, &steals);
+            break;
+    }
+    double elapsed = now_s() - start;
+    
+    long result = 0;
+    for (long s : sp.sums) {
+        result += s;
+    }
+    if (*expected < 0) {
+        *expected = result;
+    }
+    std::vector<double> lat = sp.latency;
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double q) { return lat[std::min(lat.size() - 1, (size_t)(q * lat.size()))] * 1e6; };
+    char steal_text[24] = "-";
+    if (mode == SKEW_STEALING) {
+        snprintf(steal_text, sizeof(steal_text), "%ld", steals);
+    }
+    printf("%-17s %7d %9.3fs %12.0f %10.0f %10.0f %10.0f %8s %10ld%s\n", name, threads, elapsed,
+           cfg.batches / elapsed, pct(0.50), pct(0.99), lat.back() * 1e6, steal_text, result,
+           result == *expected ? "" : " [MISMATCH]");
+}
+
+void test_work_stealing(int argc, char** argv) {
+    SkewConfig cfg;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.workers = (argc > 2) ? std::atoi(argv[2]) : (int)cores;
+    cfg.batches = (argc > 3) ? std::atol(argv[3]) : 4000;
+    // Por defecto el filtro cuesta 10 veces mas que las otras etapas
+    cfg.stage_us[0] = (argc > 4) ? std::atoi(argv[4]) : 5;
+    cfg.stage_us[1] = (argc > 5) ? std::atoi(argv[5]) : 50;
+    cfg.stage_us[2] = (argc > 6) ? std::atoi(argv[6]) : 5;
+    cfg.window = 16;
+    if (cfg.workers < 1 || cfg.batches < 1) {
+        printf("Workers and batches must be positive\n");
+        return;
+    }
+    
+    printf("\n=== Skewed Stages: barrier vs thread-per-stage vs work-stealing ===\n");
+    printf("batches %ld, window %d, stage cost %d/%d/%d us, cores %ld\n", cfg.batches, cfg.window,
+           cfg.stage_us[0], cfg.stage_us[1], cfg.stage_us[2], cores);
+    printf("%-17s %7s %10s %12s %10s %10s %10s %8s %10s\n", "mode", "threads", "time", "batches/sec",
+           "p50 us", "p99 us", "max us", "steals", "result");
+    long expected = -1;
+    run_skew_mode(SKEW_BARRIER, cfg, &expected);
+    run_skew_mode(SKEW_PINNED, cfg, &expected);
+    run_skew_mode(SKEW_STEALING, cfg, &expected);
+}
+
+// ---------------------------------------------------------------------------
+// Cientos de instancias del pipeline: corrutinas sobre N threads contra un
+// thread por etapa. Cada instancia es el pipeline wavefront (TICKS lotes,
+// semilla 1), asi todas deben dar el resultado del test 1.
+// ---------------------------------------------------------------------------
+
+// Resultado esperado de cada instancia; test_coro_instances lo calcula antes
+// de correr los modos
+static long coro_expected = 0;
+
+// Referencia: el mismo dato por la ruta escalar en un solo thread
+long scalar_wavefront_result() {
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    int data[BUFFER_SIZE];
+    int kept[BUFFER_SIZE];
+    long total = 0;
+    for (int t = 0; t < TICKS; t++) {
+        long sum;
+        philox_fill(&rng, data, BUFFER_SIZE, 1, 100);
+        filter_sum_scalar(data, BUFFER_SIZE, kept, &sum);
+        total += sum;
+    }
+    return total;
+}
+
+struct ScaleResult {
+    double seconds;
+    long wrong_results;    // Instancias que no dieron coro_expected
+    long setup_allocs;     // Reservas al armar las instancias
+    long setup_bytes;
+    long run_allocs;       // Reservas mientras corren (camino caliente)
+    long max_rss_kb;
+    long base_rss_kb;      // RSS del hijo antes de armar nada
+    long voluntary_cs;
+    long involuntary_cs;
+    long resumes;          // Solo corrutinas
+    int threads;
+};
+
+// Modo thread por etapa: tres pthreads y dos StageChannel por instancia
+struct ThreadInstance {
+    StageChannel<TickBatch> edge1;
+    StageChannel<TickBatch> edge2;
+    long result;
+    
+    ThreadInstance() : edge1(WAVEFRONT_WINDOW), edge2(WAVEFRONT_WINDOW), result(0) {}
+};
+
+void* thread_instance_generator(void* p) {
+    ThreadInstance* inst = static_cast<ThreadInstance*>(p);
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    TickBatch batch;
+    for (int t = 0; t < TICKS; t++) {
+        batch.tick = t;
+        batch.count = BUFFER_SIZE;
+        philox_fill(&rng, batch.data, BUFFER_SIZE, 1, 100);
+        inst->edge1.push(batch);
+    }
+    inst->edge1.close();
+    return nullptr;
+}
+
+void* thread_instance_filter(void* p) {
+    ThreadInstance* inst = static_cast<ThreadInstance*>(p);
+    TickBatch in, out;
+    while (inst->edge1.pop(&in)) {
+        long ignored_sum;
+        out.tick = in.tick;
+        out.count = filter_sum()(in.data, in.count, out.data, &ignored_sum);
+        inst->edge2.push(out);
+    }
+    inst->edge2.close();
+    return nullptr;
+}
+
+void* thread_instance_reducer(void* p) {
+    ThreadInstance* inst = static_cast<ThreadInstance*>(p);
+    TickBatch in;
+    while (inst->edge2.pop(&in)) {
+        inst->result += sum_ints()(in.data, in.count);
+    }
+    return nullptr;
+}
+
+void run_thread_instances(int instances, ScaleResult* res) {
+    long allocs0 = heap_allocs.load(), bytes0 = heap_bytes.load();
+    std::vector<ThreadInstance*> insts(instances);
+    std::vector<pthread_t> threads(3 * instances);
+    for (ThreadInstance*& inst : insts) {
+        inst = new ThreadInstance();
+    }
+    res->setup_allocs = heap_allocs.load() - allocs0;
+    res->setup_bytes = heap_bytes.load() - bytes0;
+    res->threads = 3 * instances;
+    
+    long allocs1 = heap_allocs.load();
+    double start = now_s();
+    for (int i = 0; i < instances; i++) {
+        pthread_create(&threads[3 * i], nullptr, thread_instance_generator, insts[i]);
+        pthread_create(&threads[3 * i + 1], nullptr, thread_instance_filter, insts[i]);
+        pthread_create(&threads[3 * i + 2], nullptr, thread_instance_reducer, insts[i]);
+    }
+    for (pthread_t& th : threads) {
+        pthread_join(th, nullptr);
+    }
+    res->seconds = now_s() - start;
+    res->run_allocs = heap_allocs.load() - allocs1;
+    
+    for (ThreadInstance* inst : insts) {
+        res->wrong_results += inst->result != coro_expected;
+        delete inst;
+    }
+}
+
+#ifdef CORO_PIPELINE_AVAILABLE
+
+typedef CoroChannel<TickBatch, WAVEFRONT_WINDOW> CoroEdge;
+
+CoroTask coro_generator(CoroEdge* out) {
+    Philox4x32 rng;
+    philox_seed(&rng, 1, 0);
+    TickBatch batch;
+    for (int t = 0; t < TICKS; t++) {
+        batch.tick = t;
+        batch.count = BUFFER_SIZE;
+        philox_fill(&rng, batch.data, BUFFER_SIZE, 1, 100);
+        co_await out->push(batch);
+    }
+    out->close();
+}
+
+CoroTask coro_filter(CoroEdge* in, CoroEdge* out) {
+    TickBatch batch, filtered;
+    while (co_await in->pop(&batch)) {
+        long ignored_sum;
+        filtered.tick = batch.tick;
+        filtered.count = filter_sum()(batch.data, batch.count, filtered.data, &ignored_sum);
+        co_await out->push(filtered);
+    }
+    out->close();
+}
+
+CoroTask coro_reducer(CoroEdge* in, long* result) {
+    TickBatch batch;
+    while (co_await in->pop(&batch)) {
+        *result += sum_ints()(batch.data, batch.count);
+    }
+}
+
+struct CoroInstance {
+    CoroEdge edge1;
+    CoroEdge edge2;
+    long result;
+    CoroTask tasks[3];
+    
+    explicit CoroInstance(CoroScheduler* sched)
+        : edge1(sched), edge2(sched), result(0),
+          tasks{coro_generator(&edge1), coro_filter(&edge1, &edge2), coro_reducer(&edge2, &result)} {}
+    
+    ~CoroInstance() {
+        for (CoroTask& t : tasks) {
+            t.destroy();
+        }
+    }
+};
+
+void run_coro_instances(int instances, int threads, ScaleResult* res) {
+    long allocs0 = heap_allocs.load(), bytes0 = heap_bytes.load();
+    CoroScheduler sched(3 * instances, threads);
+    std::vector<CoroInstance*> insts(instances);
+    for (CoroInstance*& inst : insts) {
+        inst = new CoroInstance(&sched);
+        for (CoroTask& t : inst->tasks) {
+            t.start(&sched);
+        }
+    }
+    res->setup_allocs = heap_allocs.load() - allocs0;
+    res->setup_bytes = heap_bytes.load() - bytes0;
+    res->threads = threads;
+    
+    long allocs1 = heap_allocs.load();
+    double start = now_s();
+    sched.run();
+    res->seconds = now_s() - start;
+    res->run_allocs = heap_allocs.load() - allocs1;
+    res->resumes = sched.resumes.load();
+    
+    for (CoroInstance* inst : insts) {
+        res->wrong_results += inst->result != coro_expected;
+        delete inst;
+    }
+}
+
+#endif  // CORO_PIPELINE_AVAILABLE
+
+// Un modo con sus contadores de getrusage alrededor
+void run_scale_mode(bool coro, int instances, int threads, ScaleResult* res) {
+    memset(res, 0, sizeof(*res));
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    res->base_rss_kb = ru.ru_maxrss;
+    long nvcsw0 = ru.ru_nvcsw;
+    long nivcsw0 = ru.ru_nivcsw;
+#ifdef CORO_PIPELINE_AVAILABLE
+    if (coro) {
+        run_coro_instances(instances, threads, res);
+    } else {
+        run_thread_instances(instances, res);
+    }
+#else
+    (void)coro;
+    (void)threads;
+    run_thread_instances(instances, res);
+#endif
+    getrusage(RUSAGE_SELF, &ru);
+    res->max_rss_kb = ru.ru_maxrss;
+    res->voluntary_cs = ru.ru_nvcsw - nvcsw0;
+    res->involuntary_cs = ru.ru_nivcsw - nivcsw0;
+}
+
+// Corre un modo en un proceso hijo para que ru_maxrss y los cambios de
+// contexto sean solo de esa corrida
+bool run_scale_child(bool coro, int instances, int threads, ScaleResult* out) {
+#ifdef P5_UNDER_TSAN
+    run_scale_mode(coro, instances, threads, out);
+    return true;
+#else
+    fflush(stdout);
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        ScaleResult res;
+        run_scale_mode(coro, instances, threads, &res);
+        ssize_t w = write(fds[1], &res, sizeof(res));
+        _exit(w == (ssize_t)sizeof(res) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = pid > 0 && read(fds[0], out, sizeof(*out)) == (ssize_t)sizeof(*out);
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+    }
+    return ok;
+#endif
+}
+
+static void print_scale_row(const char* name, int instances, const ScaleResult& r) {
+    double per_instance_kb = (double)(r.max_rss_kb - r.base_rss_kb) / instances;
+    printf("%-16s %7d %8.3fs %11.1f %12.1f %10ld %10ld %10ld %6ld %s\n", name, r.threads, r.seconds,
+           per_instance_kb, (double)r.setup_bytes / instances / 1024.0, r.run_allocs,
+           r.voluntary_cs + r.involuntary_cs, r.resumes, r.wrong_results,
+           r.wrong_results == 0 ? "[OK]" : "[WRONG]");
+}
+
+void test_coro_instances(int instances, int threads) {
+    printf("\n=== Pipeline Instances: coroutines on %d threads vs thread per stage (instances: %d) ===\n",
+           threads, instances);
+    pthread_attr_t attr;
+    size_t stack = 0;
+    pthread_attr_init(&attr);
+    pthread_attr_getstacksize(&attr, &stack);
+    pthread_attr_destroy(&attr);
+    printf("Default thread stack reserve: %zu KB (virtual, per thread)\n", stack / 1024);
+    coro_expected = scalar_wavefront_result();
+    printf("Expected result per instance (scalar reference): %ld\n", coro_expected);
+#ifdef P5_UNDER_TSAN
+    printf("TSan build: modes run in this process, not in forked children; RSS is cumulative\n");
+#endif
+    printf("%-16s %7s %9s %11s %12s %10s %10s %10s %6s\n", "mode", "threads", "time",
+           "RSS KB/inst", "heap KB/inst", "run allocs", "ctx switch", "resumes", "wrong");
+    
+    ScaleResult res;
+    if (run_scale_child(false, instances, threads, &res)) {
+        print_scale_row("thread-per-stage", instances, res);
+    } else {
+        printf("thread-per-stage run failed\n");
+    }
+#ifdef CORO_PIPELINE_AVAILABLE
+    if (run_scale_child(true, instances, threads, &res)) {
+        print_scale_row("coroutines", instances, res);
+    } else {
+        printf("coroutine run failed\n");
+    }
+#else
+    printf("coroutines: needs C++20 with <coroutine> (build p5 with -std=c++20)\n");
+#endif
+}
+
+// Kernels de filtro/suma: verificacion contra el escalar y GB/s de entrada
+void test_simd_kernels() {
+    SimdLevel best = simd_detect();
+    printf("\n=== SIMD Filter/Sum Kernels (detected: %s) ===\n", simd_level_name(best));
+    
+    std::vector<SimdLevel> levels = {SIMD_SCALAR};
+    if (best >= SIMD_SSE4) {
+        levels.push_back(SIMD_SSE4);
+    }
+    if (best >= SIMD_AVX2) {
+        levels.push_back(SIMD_AVX2);
+    }
+    
+    // Correctitud: rangos con negativos y bordes del predicado, largos que no
+    // son multiplo del ancho del vector
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> wide(-1000, 1000);
+    bool ok = true;
+    for (int n = 0; n <= 300 && ok; n++) {
+        std::vector<int> in(n);
+        for (int i = 0; i < n; i++) {
+            int r = gen() % 8;
+            in[i] = r == 0 ? 20 : r == 1 ? 21 : r == 2 ? 22 : r == 3 ? INT32_MIN : wide(gen);
+        }
+        std::vector<int> ref(n + SIMD_OUT_SLACK), out(n + SIMD_OUT_SLACK);
+        long ref_sum;
+        int ref_kept = filter_sum_scalar(in.data(), n, ref.data(), &ref_sum);
+        long ref_total = sum_scalar(in.data(), n);
+        for (SimdLevel level : levels) {
+            long got_sum;
+            int kept = filter_sum_for(level)(in.data(), n, out.data(), &got_sum);
+            // En sitio, como lo usa el pool de lotes
+            std::vector<int> inplace(in);
+            inplace.resize(n + SIMD_OUT_SLACK);
+            long inplace_sum;
+            int inplace_kept = filter_sum_for(level)(inplace.data(), n, inplace.data(), &inplace_sum);
+            if (kept != ref_kept || got_sum != ref_sum ||
+                !std::equal(ref.begin(), ref.begin() + ref_kept, out.begin()) ||
+                inplace_kept != ref_kept || inplace_sum != ref_sum ||
+                !std::equal(ref.begin(), ref.begin() + ref_kept, inplace.begin()) ||
+                sum_for(level)(in.data(), n) != ref_total) {
+                printf("MISMATCH: %s with n=%d\n", simd_level_name(level), n);
+                ok = false;
+            }
+        }
+    }
+    printf("Correctness vs scalar (n = 0..300): %s\n", ok ? "[OK]" : "[FAILED]");
+    
+    // Rendimiento: 1M enteros con el mismo rango que el generador (1..100)
+    const int N = 1 << 20;
+    const int REPS = 50;
+    std::vector<int> in(N), out(N + SIMD_OUT_SLACK);
+    std::uniform_int_distribution<> dis(1, 100);
+    for (int& v : in) {
+        v = dis(gen);
+    }
+    double bytes = (double)N * sizeof(int) * REPS;
+    
+    printf("%-8s %18s %14s\n", "kernel", "filter+sum GB/s", "sum GB/s");
+    for (SimdLevel level : levels) {
+        FilterSumFn fs = filter_sum_for(level);
+        SumFn sm = sum_for(level);
+        volatile long sink = 0;
+        
+        double start = now_s();
+        for (int r = 0; r < REPS; r++) {
+            long sum;
+            int kept = fs(in.data(), N, out.data(), &sum);
+            sink = sink + kept + sum;
+        }
+        double fs_time = now_s() - start;
+        
+        start = now_s();
+        for (int r = 0; r < REPS; r++) {
+            sink = sink + sm(in.data(), N);
+        }
+        double sum_time = now_s() - start;
+        
+        printf("%-8s %18.2f %14.2f\n", simd_level_name(level), bytes / fs_time / 1e9, bytes / sum_time / 1e9);
+    }
+}
+
+// Generacion de lotes: mt19937 + uniform_int_distribution contra Philox
+void test_batch_rng() {
+    printf("\n=== Batch PRNG (values in [1, 100]) ===\n");
+    
+    // El llenado AVX2 debe dar la misma secuencia que el escalar
+    bool avx2 = philox_has_avx2();
+    bool same = true;
+    if (avx2) {
+        Philox4x32 a, b;
+        philox_seed(&a, 7, 3);
+        philox_seed(&b, 7, 3);
+        for (int n = 1; n <= 200 && same; n++) {
+            std::vector<int> x(n), y(n);
+            philox_fill_scalar(&a, x.data(), n, 1, 100);
+            philox_fill_for(true)(&b, y.data(), n, 1, 100);
+            same = (x == y);
+        }
+        printf("Philox avx2 vs scalar stream: %s\n", same ? "[OK]" : "[MISMATCH]");
+    }
+    
+    const int REPS = 20000;   // Lotes de BUFFER_SIZE, como en el generador
+    int batch[BUFFER_SIZE];
+    volatile long sink = 0;
+    double values = (double)REPS * BUFFER_SIZE;
+    
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<> dis(1, 100);
+    double start = now_s();
+    for (int r = 0; r < REPS; r++) {
+        for (int i = 0; i < BUFFER_SIZE; i++) {
+            batch[i] = dis(gen);
+        }
+        sink = sink + batch[r % BUFFER_SIZE];
+    }
+    double mt_rate = values / (now_s() - start);
+    printf("%-22s %8.1f M values/sec\n", "mt19937 + uniform_int", mt_rate / 1e6);
+    
+    for (int use_avx2 = 0; use_avx2 <= (avx2 ? 1 : 0); use_avx2++) {
+        PhiloxFillFn fill = philox_fill_for(use_avx2);
+        Philox4x32 rng;
+        philox_seed(&rng, 1, 0);
+        start = now_s();
+        for (int r = 0; r < REPS; r++) {
+            fill(&rng, batch, BUFFER_SIZE, 1, 100);
+            sink = sink + batch[r % BUFFER_SIZE];
+        }
+        double rate = values / (now_s() - start);
+        printf("%-22s %8.1f M values/sec (x%.1f)\n",
+               use_avx2 ? "philox4x32-10 avx2" : "philox4x32-10 scalar", rate / 1e6, rate / mt_rate);
+    }
+}
+
+// Micro-benchmark: latencia por episodio de cada barrera segun el numero de threads
+struct BarrierBenchArgs {
+    StageBarrier* barrier;
+    int tid;
+    int episodes;
+    double seconds;   // Solo lo mide el thread 0
+};
+
+void* barrier_bench_worker(void* p) {
+    BarrierBenchArgs* args = static_cast<BarrierBenchArgs*>(p);
+    // Primer episodio fuera de la medicion: espera a que todos hayan arrancado
+    stage_barrier_wait(args->barrier, args->tid);
+    double start = now_s();
+    for (int e = 0; e < args->episodes; e++) {
+        stage_barrier_wait(args->barrier, args->tid);
+    }
+    args->seconds = now_s() - start;
+    return nullptr;
+}
+
+void test_barrier_bench(int max_threads) {
+    max_threads = std::min(std::max(max_threads, 2), BARRIER_MAX_THREADS);
+    const BarrierKind kinds[] = {BARRIER_NATIVE, BARRIER_CONDVAR, BARRIER_SENSE,
+                                 BARRIER_TREE, BARRIER_DISSEMINATION};
+    
+    printf("\n=== Barrier Micro-benchmark (ns per episode) ===\n");
+    printf("%-8s", "threads");
+    for (BarrierKind kind : kinds) {
+        printf(" %14s", barrier_name(kind));
+    }
+    printf("\n");
+    
+    for (int n = 2; n <= max_threads; n *= 2) {
+        int episodes = std::max(200, 20000 / n);
+        printf("%-8d", n);
+        for (BarrierKind kind : kinds) {
+            StageBarrier b;
+            stage_barrier_init(&b, kind, n);
+            std::vector<pthread_t> threads(n);
+            std::vector<BarrierBenchArgs> args(n);
+            for (int i = 0; i < n; i++) {
+                args[i] = {&b, i, episodes, 0};
+                pthread_create(&threads[i], nullptr, barrier_bench_worker, &args[i]);
+            }
+            for (int i = 0; i < n; i++) {
+                pthread_join(threads[i], nullptr);
+            }
+            stage_barrier_destroy(&b);
+            printf(" %14.0f", args[0].seconds * 1e9 / episodes);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+}
+
+// Costo de un handoff (push + pop) con un backlog fijo de B elementos:
+// el vector con erase(begin) original contra StageChannel
+void test_backlog_sweep() {
+    printf("\n=== Stage Channel Backlog Sweep (items/sec per push+pop) ===\n");
+    printf("%-10s %16s %16s\n", "backlog", "vector-erase", "StageChannel");
+    
+    const size_t backlogs[] = {1000, 10000, 100000, 1000000};
+    for (size_t backlog : backlogs) {
+        // El vector mueve todo el backlog en cada pop: acotar el trabajo total
+        long ops = std::max(1000L, std::min(200000L, (long)(200000000 / backlog)));
+        
+        std::vector<int> vec(backlog, 1);
+        volatile long sink = 0;   // Evita que el compilador descarte los pops
+        double start = now_s();
+        for (long i = 0; i < ops; i++) {
+            vec.push_back((int)i);
+            sink = sink + vec.front();
+            vec.erase(vec.begin());
+        }
+        double vec_rate = ops / (now_s() - start);
+        
+        StageChannel<int> ch(backlog + 1);
+        for (size_t i = 0; i < backlog; i++) {
+            ch.push(1);
+        }
+        long chan_ops = 200000;
+        start = now_s();
+        for (long i = 0; i < chan_ops; i++) {
+            int v = 0;
+            ch.push((int)i);
+            ch.pop(&v);
+            sink = sink + v;
+        }
+        double chan_rate = chan_ops / (now_s() - start);
+        
+        printf("%-10zu %16.0f %16.0f\n", backlog, vec_rate, chan_rate);
+    }
 }
 
 int main(int argc, char** argv) {
+    argc = parse_log_flag(argc, argv);
+    async_log_start();
     int test_type = (argc > 1) ? std::atoi(argv[1]) : 1;
     
+    BarrierKind kind = BARRIER_NATIVE;
+    if ((test_type == 1 || test_type == 2) && argc > 2 && !parse_barrier_kind(argv[2], &kind)) {
+        printf("Unknown barrier '%s' (native|condvar|sense|tree|dissemination)\n", argv[2]);
+        async_log_stop();
+        return 1;
+    }
+    
     switch (test_type) {
         case 1:
-            test_pipeline(3);
+            test_pipeline(3, kind);
             break;
         case 2:
-            test_pipeline(4); // Incluir etapa de monitoreo
+            test_pipeline(4, kind); // Incluir etapa de monitoreo
+            break;
+        case 3: {
+            QueueConfig cfg = QUEUE_DEFAULT;
+            cfg.chunk = (argc > 2) ? std::max(1L, std::atol(argv[2])) : cfg.chunk;
+            cfg.credits = (argc > 3) ? std::max(1L, std::atol(argv[3])) : cfg.credits;
+            cfg.work_us = (argc > 4) ? std::atoi(argv[4]) : cfg.work_us;
+            test_queue_pipeline(cfg);
+            break;
+        }
+        case 4:
+            test_barrier_bench((argc > 2) ? std::atoi(argv[2]) : BARRIER_MAX_THREADS);
+            break;
+        case 5:
+            test_backlog_sweep();
+            break;
+        case 6:
+            test_wavefront_compare((argc > 2) ? std::atoi(argv[2]) : 20, BARRIER_NATIVE);
+            break;
+        case 7:
+            test_replicated(argc, argv);
+            break;
+        case 8:
+            test_simd_kernels();
+            break;
+        case 9:
+            test_batch_rng();
+            break;
+        case 10:
+            test_batch_pool((argc > 2) ? std::atol(argv[2]) : 200000);
+            break;
+        case 11:
+            test_queue_flow_sweep((argc > 2) ? std::atol(argv[2]) : 1 << 20);
+            break;
+        case 12:
+            test_stage_framework((argc > 2) ? std::atol(argv[2]) : 1 << 22, (argc > 3) ? std::atoi(argv[3]) : 2);
+            break;
+        case 13:
+            test_work_stealing(argc, argv);
             break;
-        case 3:
-            test_queue_pipeline();
+        case 14:
+            test_coro_instances((argc > 2) ? std::max(1, std::atoi(argv[2])) : 300,
+                                (argc > 3) ? std::max(1, std::atoi(argv[3])) : 4);
             break;
         default:
-            printf("Usage: %s <test_type>\n", argv[0]);
-            printf("  1: 3-stage barrier pipeline\n");
-            printf("  2: 4-stage pipeline with monitor\n");
-            printf("  3: Queue-based pipeline\n");
+            printf("Usage: %s <test_type> [--sync-log]\n", argv[0]);
+            printf("  1: 3-stage barrier pipeline [barrier]\n");
+            printf("  2: 4-stage pipeline with monitor [barrier]\n");
+            printf("  3: Queue-based pipeline [chunk] [credits] [work_us]\n");
+            printf("  4: Barrier micro-benchmark [max_threads]\n");
+            printf("  5: Stage channel backlog sweep\n");
+            printf("  6: Barrier vs wavefront ticks [work_us_per_batch]\n");
+            printf("  7: Replicated stages [generators] [filters] [reducers] [batches] [work_us]\n");
+            printf("  8: SIMD filter/sum kernels (correctness and GB/s)\n");
+            printf("  9: Batch PRNG throughput (mt19937 vs Philox)\n");
+            printf(" 10: Recycled batch pool vs new/delete per batch [batches]\n");
+            printf(" 11: Queue pipeline chunk x credits sweep (throughput, peak RSS) [items]\n");
+            printf(" 12: Typed stage framework, fused vs unfused [items] [filter_threads]\n");
+            printf(" 13: Skewed stages, barrier vs pinned vs work-stealing [workers] [batches] [gen_us] [filter_us] [reduce_us]\n");
+            printf(" 14: Coroutine pipeline instances vs thread per stage [instances] [threads]\n");
+            printf("  barrier: native|condvar|sense|tree|dissemination\n");
             printf("\nRunning all tests...\n");
             
-            test_pipeline(3);
+            test_pipeline(3, kind);
             
             // Reset para el siguiente test
-            pipeline_data.raw_data.clear();
-            pipeline_data.filtered_data.clear();
-            pipeline_data.processed_data.clear();
+            pipeline_data.raw.reset();
+            pipeline_data.filtered.reset();
             pipeline_data.final_result = 0;
             
             // Reinicializar once_flag correctamente
             static pthread_once_t new_once_flag = PTHREAD_ONCE_INIT;
             once_flag = new_once_flag;
             
-            test_pipeline(4);
-            test_queue_pipeline();
+            test_pipeline(4, kind);
+            test_queue_pipeline(QUEUE_DEFAULT);
             break;
     }
     
+    async_log_stop();
+    print_async_log_stats();
     return 0;
 }